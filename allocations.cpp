@@ -0,0 +1,89 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "allocations.h"
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+static std::atomic<uint64_t> allocations(0);
+static thread_local uint64_t thread_allocations = 0;
+
+uint64_t allocation_count()
+{
+  return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t thread_allocation_count()
+{
+  return thread_allocations;
+}
+
+#ifdef ALLOCATION_AUDIT
+static uint64_t audit_failures = 0;
+
+void AllocationAudit::end()
+{
+  if(m_name == nullptr)
+    return;
+  uint64_t allocations = thread_allocation_count() - m_start;
+  if(allocations > 0) {
+    audit_failures++;
+    debug_error << m_name << " has allocated memory " << allocations << " times" << std::endl;
+  }
+  m_name = nullptr;
+}
+
+uint64_t AllocationAudit::failures()
+{
+  return audit_failures;
+}
+#endif
+
+void *operator new(size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  thread_allocations++;
+  void *p = malloc(size == 0 ? 1 : size);
+  if(p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void *p, size_t size) noexcept
+{
+  free(p);
+}
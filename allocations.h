@@ -0,0 +1,68 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ALLOCATIONS_H__
+#define __ALLOCATIONS_H__
+
+#include <stdint.h>
+
+/** Number of calls to operator new since panel has been started.
+ *  Global operator new is replaced to count them.
+ */
+uint64_t allocation_count();
+/** Number of calls to operator new made by the calling thread. Audits use 
+ *  it, so allocations of worker threads aren't counted in the main thread.
+ */
+uint64_t thread_allocation_count();
+
+#ifdef ALLOCATION_AUDIT
+/*! \class AllocationAudit
+ *  \brief Reports an error if memory is allocated while it exists.
+ *
+ *  Used in paths which must not allocate once panel is running: partial 
+ *  repaints and clock ticks. It is only built with -DALLOCATION_AUDIT=ON.
+ */
+class AllocationAudit
+{
+public:
+  /** If name is nullptr, nothing is checked. */
+  AllocationAudit(const char *name) : m_name(name), m_start(thread_allocation_count()) {}
+  ~AllocationAudit() { end(); }
+  AllocationAudit(const AllocationAudit&) = delete;
+  AllocationAudit& operator=(const AllocationAudit&) = delete;
+
+  /** Checks allocations before the end of the scope. */
+  void end();
+  /** Stops checking. Used when code leaves the steady state. */
+  void cancel() { m_name = nullptr; }
+
+  /** Number of audited scopes which have allocated memory. */
+  static uint64_t failures();
+
+private:
+  const char *m_name;
+  uint64_t m_start;
+};
+
+#define ALLOCATION_AUDIT_SCOPE(name) AllocationAudit allocation_audit(name)
+#define ALLOCATION_AUDIT_END() allocation_audit.end()
+#define ALLOCATION_AUDIT_CANCEL() allocation_audit.cancel()
+#else
+#define ALLOCATION_AUDIT_SCOPE(name)
+#define ALLOCATION_AUDIT_END()
+#define ALLOCATION_AUDIT_CANCEL()
+#endif
+
+#endif
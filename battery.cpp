@@ -20,6 +20,8 @@
 #include <iostream>
 
 
+static std::string power_supply_path = "/sys/class/power_supply/";
+
 static std::string read_line(const char *path)
 {
   std::string text;
@@ -38,7 +40,7 @@ static std::string read_line(std::string path)
 
 static std::string get_battery_path()
 {
-  std::filesystem::path path("/sys/class/power_supply/");
+  std::filesystem::path path(power_supply_path);
   std::filesystem::directory_entry entry_path(path);
   if(entry_path.exists()) {
     for(std::filesystem::directory_entry entry : std::filesystem::directory_iterator(path)) {
@@ -97,6 +99,11 @@ Battery::Battery(
   set_timeout(60000); // Battery is updated each 60 seconds
 }
 
+void Battery::set_power_supply_path(const std::string & path)
+{
+  power_supply_path = path;
+}
+
 void Battery::update_battery_level()
 {
   std::string battery_path = get_battery_path();
@@ -43,6 +43,10 @@ public:
   virtual void timeout() override;
   virtual void mouse_enter() override;
 
+  /** Directory where batteries are searched. Default is /sys/class/power_supply/.
+   */
+  static void set_power_supply_path(const std::string & path);
+
   std::function<void()> send_repaint;
 
 private:
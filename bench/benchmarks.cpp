@@ -0,0 +1,503 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Benchmarks of functions used when panel starts and when it is painted.
+ *
+ * Icon themes, desktop files and batteries are read from synthetic data 
+ * written to a temporary directory, so results of different releases can 
+ * be compared. Output is JSON by default:
+ *   yatbfw-bench --benchmark_out=new.json
+ *   compare.py benchmarks old.json new.json   (tools of Google Benchmark)
+ * Benchmarks ending in _regex run the std::regex parsers replaced by 
+ * IniFile. If YATBFW_BENCH_APPLICATIONS is set to a directory (for example
+ * /usr/share/applications), its desktop files are also read.
+ */
+
+#include <benchmark/benchmark.h>
+#include "utils.h"
+#include "settings.h"
+#include "icons.h"
+#include "iconindex.h"
+#include "inifile.h"
+#include "button.h"
+#include "battery.h"
+#include "sysmonitor.h"
+#include "slotmap.h"
+#include "toplevelbutton.h"
+#include "toplevelgroup.h"
+#include "framearena.h"
+#include <cairo/cairo.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <unordered_map>
+#include <string.h>
+#include <stdlib.h>
+
+#define THEME_ICONS 20000
+#define DESKTOP_FILES 1000
+
+static std::string data_path;
+
+static void write_file(const std::string & path, const std::string & text)
+{
+  std::ofstream out(path);
+  out << text;
+}
+
+/** Icon theme "bench" with THEME_ICONS files: each icon is in 8 sizes.
+ *  Panel searches themes in $XDG_DATA_HOME.
+ */
+static void create_theme()
+{
+  const char *contexts[] = {"apps", "actions", "devices", "places", "status", "mimetypes", "categories", "emblems"};
+  const int sizes[] = {16, 22, 24, 32, 48, 64, 128, 256};
+  std::string theme = data_path + "/bench";
+  std::string directories;
+  for(const char *context : contexts) {
+    for(int size : sizes) {
+      std::string dir = std::to_string(size) + "x" + std::to_string(size) + "/" + context;
+      std::filesystem::create_directories(theme + "/" + dir);
+      directories += dir + ",";
+    }
+    std::filesystem::create_directories(theme + "/scalable/" + context);
+    directories += std::string("scalable/") + context + ",";
+  }
+  write_file(theme + "/index.theme", "[Icon Theme]\nName=Bench\nInherits=hicolor\nDirectories=" + directories + "\n");
+  for(int n = 0; n < THEME_ICONS / 8; n++) {
+    const char *context = contexts[n % 8];
+    for(int size : sizes)
+      write_file(theme + "/" + std::to_string(size) + "x" + std::to_string(size) + "/" + context + "/icon-" + std::to_string(n) + ".png", "");
+  }
+}
+
+static void create_desktop_files()
+{
+  std::string dir = data_path + "/applications";
+  std::filesystem::create_directories(dir);
+  for(int n = 0; n < DESKTOP_FILES; n++) {
+    std::string id = "app-" + std::to_string(n);
+    write_file(dir + "/" + id + ".desktop", 
+      "[Desktop Entry]\nType=Application\nName=Application " + std::to_string(n) + 
+      "\nComment=Synthetic application\nExec=/usr/bin/" + id + " --new-window %U\nIcon=icon-" + std::to_string(n) + 
+      "\nCategories=Utility;\n\n[Desktop Action new]\nName=New window\nExec=/usr/bin/" + id + " --new\n");
+  }
+}
+
+static void create_power_supply()
+{
+  std::string dir = data_path + "/power_supply";
+  std::filesystem::create_directories(dir + "/AC");
+  std::filesystem::create_directories(dir + "/BAT0");
+  write_file(dir + "/AC/type", "Mains\n");
+  write_file(dir + "/BAT0/type", "Battery\n");
+  write_file(dir + "/BAT0/capacity", "57\n");
+  write_file(dir + "/BAT0/status", "Discharging\n");
+  Battery::set_power_supply_path(dir + "/");
+}
+
+/** A real image for buttons. Icons of the theme are empty files.
+ */
+static std::string create_icon()
+{
+  std::string path = data_path + "/app.png";
+  cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 48, 48);
+  cairo_t *cr = cairo_create(surface);
+  cairo_set_source_rgba(cr, 0.2, 0.4, 0.8, 1.0);
+  cairo_arc(cr, 24, 24, 20, 0, 6.28);
+  cairo_fill(cr);
+  cairo_destroy(cr);
+  cairo_surface_write_to_png(surface, path.c_str());
+  cairo_surface_destroy(surface);
+  return path;
+}
+
+static void create_data()
+{
+  char dir[] = "/tmp/yatbfw-bench-XXXXXX";
+  if(mkdtemp(dir) == nullptr) {
+    perror("mkdtemp");
+    exit(1);
+  }
+  data_path = dir;
+  // Icons in ~/.icons and desktop files in $XDG_DATA_HOME are synthetic ones
+  setenv("HOME", dir, 1);
+  setenv("XDG_DATA_HOME", dir, 1);
+  create_theme();
+  create_desktop_files();
+  create_power_supply();
+  write_file(data_path + "/yatbfw.json", R"({"icon_theme": "bench", "size": 48, "font": "Sans", "font_size": 14})");
+  Settings::get_settings()->load_settings(data_path + "/yatbfw.json", nullptr);
+}
+
+static void BM_get_lines(benchmark::State & state)
+{
+  std::string text;
+  for(int n = 0; n < state.range(0); n++)
+    text += "Line " + std::to_string(n) + " of tooltip\n";
+  for(auto _ : state) {
+    benchmark::DoNotOptimize(get_lines(text));
+    FrameArena::get_arena()->reset();
+  }
+}
+BENCHMARK(BM_get_lines)->Arg(1)->Arg(8)->Arg(64);
+
+// Icon search in disk, used until index is ready
+static void BM_suggested_icon_for_id(benchmark::State & state)
+{
+  std::string id = state.range(0) ? "icon-2000" : "missing-icon";
+  for(auto _ : state)
+    benchmark::DoNotOptimize(Icon::suggested_icon_for_id(id));
+}
+BENCHMARK(BM_suggested_icon_for_id)->ArgName("found")->Arg(1)->Arg(0)->Unit(benchmark::kMillisecond);
+
+static void BM_read_index_theme(benchmark::State & state)
+{
+  std::string path = data_path + "/bench";
+  for(auto _ : state)
+    benchmark::DoNotOptimize(read_index_theme_paths(path, 48));
+}
+BENCHMARK(BM_read_index_theme);
+
+// Parser of index.theme used before IniFile
+static void BM_read_index_theme_regex(benchmark::State & state)
+{
+  std::string path = data_path + "/bench/index.theme";
+  for(auto _ : state) {
+    std::vector<std::string> paths, parents;
+    std::regex re_directories("^Directories=.*"), re_parents("^Inherits=.*");
+    std::ifstream in(path);
+    for(std::string line; std::getline(in, line); ) {
+      if(std::regex_match(line, re_directories)) {
+        std::stringstream buff(line.substr(12));
+        std::string item;
+        while(getline(buff, item, ','))
+          paths.push_back(item);
+      } else if(std::regex_match(line, re_parents)) {
+        std::stringstream buff(line.substr(9));
+        std::string item;
+        while(getline(buff, item, ','))
+          parents.push_back(item);
+      }
+    }
+    benchmark::DoNotOptimize(paths.data());
+  }
+}
+BENCHMARK(BM_read_index_theme_regex);
+
+static void BM_read_desktop_file(benchmark::State & state)
+{
+  std::string path = data_path + "/applications/app-1.desktop";
+  for(auto _ : state) {
+    IniFile in(path);
+    benchmark::DoNotOptimize(in.get("Desktop Entry", "Icon"));
+  }
+}
+BENCHMARK(BM_read_desktop_file);
+
+// Parser of desktop files used before IniFile
+static void BM_read_desktop_file_regex(benchmark::State & state)
+{
+  std::string path = data_path + "/applications/app-1.desktop";
+  for(auto _ : state) {
+    std::string icon;
+    std::ifstream in(path);
+    std::regex re("^Icon=(.*)");
+    for(std::string line; std::getline(in, line); ) {
+      std::smatch m;
+      if(std::regex_match(line, m, re)) {
+        icon = m[1];
+        break;
+      }
+    }
+    benchmark::DoNotOptimize(icon.data());
+  }
+}
+BENCHMARK(BM_read_desktop_file_regex);
+
+// Index task of an applications directory (replaces init_icon_exec_map)
+static void BM_read_desktop_files(benchmark::State & state, std::string dir)
+{
+  for(auto _ : state) {
+    IconIndexPartial partial;
+    ToplevelButton::index_desktop_files(dir, partial);
+    benchmark::DoNotOptimize(partial.execs.size());
+  }
+}
+
+// init_icon_exec_map before IniFile
+static void BM_read_desktop_files_regex(benchmark::State & state, std::string dir)
+{
+  for(auto _ : state) {
+    std::unordered_map<std::string, std::string> execs;
+    std::error_code error;
+    for(const std::filesystem::directory_entry & entry : std::filesystem::directory_iterator(dir, error)) {
+      if(entry.path().extension() != ".desktop")
+        continue;
+      std::ifstream in(entry.path().c_str());
+      std::regex re_icon("^Icon=(.*)");
+      std::regex re_exec("^Exec=([^ ]*).*");
+      std::string icon, exec;
+      for(std::string line; std::getline(in, line); ) {
+        std::smatch m;
+        if(std::regex_match(line, m, re_icon))
+          icon = m[1];
+        else if(std::regex_match(line, m, re_exec))
+          exec = std::filesystem::path(m[1].str()).filename();
+      }
+      execs[exec] = icon;
+    }
+    benchmark::DoNotOptimize(execs.size());
+  }
+}
+
+// Startup index of icons and desktop files (replaces init_icon_exec_map)
+static void BM_icon_index(benchmark::State & state)
+{
+  for(auto _ : state) {
+    IconIndex index;
+    Icon::add_index_tasks(&index);
+    ToplevelButton::add_index_tasks(&index);
+    index.start();
+    index.wait();
+    benchmark::DoNotOptimize(index.find_icon("icon-1"));
+  }
+}
+BENCHMARK(BM_icon_index)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_icon_index_find(benchmark::State & state)
+{
+  static IconIndex index;
+  if(!index.ready()) {
+    Icon::add_index_tasks(&index);
+    ToplevelButton::add_index_tasks(&index);
+    index.start();
+    index.wait();
+  }
+  int n = 0;
+  for(auto _ : state) {
+    benchmark::DoNotOptimize(index.find_icon("icon-" + std::to_string(n)));
+    benchmark::DoNotOptimize(index.find_exec("app-" + std::to_string(n)));
+    n = (n + 1) % DESKTOP_FILES;
+  }
+}
+BENCHMARK(BM_icon_index_find);
+
+/*! \struct Canvas
+ *  \brief Image surface where items are painted.
+ */
+struct Canvas
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  Canvas() 
+  {
+    surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 400, 48);
+    cr = cairo_create(surface);
+  }
+  ~Canvas() 
+  {
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+  }
+};
+
+static void BM_button_update_size(benchmark::State & state)
+{
+  Canvas canvas;
+  Button button(data_path + "/app.png", "Application");
+  button.set_height(48);
+  for(auto _ : state) {
+    button.update_size(canvas.cr);
+    FrameArena::get_arena()->reset();
+  }
+}
+BENCHMARK(BM_button_update_size);
+
+static void BM_button_paint(benchmark::State & state)
+{
+  Canvas canvas;
+  Button button(data_path + "/app.png", "Application");
+  button.set_height(48);
+  button.update_size(canvas.cr);
+  for(auto _ : state) {
+    button.paint(canvas.cr);
+    FrameArena::get_arena()->reset();
+  }
+}
+BENCHMARK(BM_button_paint);
+
+static void BM_panel_item_repaint(benchmark::State & state)
+{
+  Canvas canvas;
+  Button button(data_path + "/app.png", "Application");
+  button.set_height(48);
+  // Hover makes repaint blend background and foreground colors
+  if(state.range(0))
+    button.on_mouse_enter(1, 1);
+  for(auto _ : state) {
+    button.repaint(canvas.cr);
+    FrameArena::get_arena()->reset();
+  }
+}
+BENCHMARK(BM_panel_item_repaint)->ArgName("hover")->Arg(0)->Arg(1);
+
+static void BM_battery_update(benchmark::State & state)
+{
+  Battery battery("battery-full", "battery-good", "battery-medium", "battery-low", "battery-empty", "battery-charging", "battery-charged", false);
+  battery.send_repaint = []() {};
+  for(auto _ : state)
+    battery.timeout();
+}
+BENCHMARK(BM_battery_update);
+
+static void BM_sysmonitor_sample(benchmark::State & state)
+{
+  SysMonitor monitor(1000, 64);
+  for(auto _ : state)
+    benchmark::DoNotOptimize(monitor.sample());
+}
+BENCHMARK(BM_sysmonitor_sample);
+
+// Application ids sent by usual applications
+static const char *app_ids[] = {
+  "org.mozilla.firefox", "code", "org.gnome.Nautilus", "foot", "Alacritty",
+  "org.kde.konsole", "thunderbird", "org.gnome.Evince", "libreoffice-writer",
+  "gimp-2.10", "org.telegram.desktop", "Slack", "chromium", "vlc", "steam"
+};
+#define APP_IDS (sizeof(app_ids) / sizeof(app_ids[0]))
+
+// Window without compositor handle. Events are sent calling on_app_id,...
+static std::shared_ptr<ToplevelButton> create_toplevel(ToplevelList *list)
+{
+  auto toplevel = std::make_shared<ToplevelButton>(wayland::zwlr_foreign_toplevel_handle_v1_t(), wayland::seat_t(), list);
+  toplevel->repaint_main_interface = [](bool update_items_only) {};
+  return toplevel;
+}
+
+// Windows are closed and opened while 1000 windows are open
+static void BM_slotmap_churn(benchmark::State & state)
+{
+  ToplevelList list;
+  std::vector<SlotHandle> handles;
+  for(int n = 0; n < 1000; n++)
+    handles.push_back(list.buttons.insert(create_toplevel(&list)));
+  std::mt19937 random(1);
+  for(auto _ : state) {
+    size_t n = random() % handles.size();
+    std::shared_ptr<ToplevelButton> toplevel = *list.buttons.get(handles[n]);
+    list.buttons.remove(handles[n]);
+    handles[n] = list.buttons.insert(toplevel);
+    int width = 0;
+    list.buttons.for_each([&](const std::shared_ptr<ToplevelButton> & button) {
+      width += button->get_width();
+    });
+    benchmark::DoNotOptimize(width);
+  }
+}
+BENCHMARK(BM_slotmap_churn);
+
+// Same as BM_slotmap_churn, but windows receive app ids, their ids are
+// interned, icons are taken from the pool and windows are grouped by
+// application as panel does.
+static void BM_toplevel_churn(benchmark::State & state)
+{
+  bool grouped = state.range(0);
+  // Icons of application ids are cached once desktop files are indexed
+  IconIndex *index = IconIndex::get_index();
+  if(!index->ready()) {
+    Icon::add_index_tasks(index);
+    ToplevelButton::add_index_tasks(index);
+    index->start();
+    index->wait();
+  }
+  ToplevelList list;
+  std::unordered_map<const std::string *, std::shared_ptr<ToplevelGroup> > groups;
+  auto open = [&](const char *app_id) {
+    std::shared_ptr<ToplevelButton> toplevel = create_toplevel(&list);
+    toplevel->set_handle(list.buttons.insert(toplevel));
+    toplevel->closed = [&](ToplevelButton *closed) {
+      if(!grouped)
+        return;
+      auto iter = groups.find(&closed->get_app_id());
+      if(iter == groups.end())
+        return;
+      iter->second->remove(closed);
+      if(iter->second->empty())
+        groups.erase(iter);
+    };
+    toplevel->on_title(app_id);
+    toplevel->on_app_id(app_id);
+    toplevel->on_done();
+    if(grouped) {
+      std::shared_ptr<ToplevelGroup> & group = groups[&toplevel->get_app_id()];
+      if(group == nullptr)
+        group = std::make_shared<ToplevelGroup>(toplevel->get_app_id());
+      group->add(toplevel.get());
+    }
+    return toplevel.get();
+  };
+
+  std::vector<ToplevelButton *> toplevels;
+  for(size_t n = 0; n < 1000; n++)
+    toplevels.push_back(open(app_ids[n % APP_IDS]));
+  std::mt19937 random(1);
+  for(auto _ : state) {
+    size_t n = random() % toplevels.size();
+    toplevels[n]->on_closed();
+    toplevels[n] = open(app_ids[random() % APP_IDS]);
+  }
+  state.counters["groups"] = groups.size();
+}
+BENCHMARK(BM_toplevel_churn)->ArgName("grouped")->Arg(0)->Arg(1);
+
+int main(int argc, char **argv)
+{
+  create_data();
+  create_icon();
+
+  // JSON output, unless other format is requested
+  std::vector<char *> args(argv, argv + argc);
+  bool format = false;
+  for(char *arg : args)
+    format = format || !strncmp(arg, "--benchmark_format", 18) || !strncmp(arg, "--benchmark_out_format", 22);
+  char json_format[] = "--benchmark_format=json";
+  char json_out_format[] = "--benchmark_out_format=json";
+  if(!format) {
+    args.push_back(json_format);
+    args.push_back(json_out_format);
+  }
+  benchmark::RegisterBenchmark("BM_read_desktop_files", BM_read_desktop_files, data_path + "/applications")->Unit(benchmark::kMillisecond);
+  benchmark::RegisterBenchmark("BM_read_desktop_files_regex", BM_read_desktop_files_regex, data_path + "/applications")->Unit(benchmark::kMillisecond);
+  // Real desktop files are longer and have translations
+  const char *applications = getenv("YATBFW_BENCH_APPLICATIONS");
+  if(applications != nullptr) {
+    benchmark::RegisterBenchmark("BM_read_desktop_files/system", BM_read_desktop_files, std::string(applications))->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_read_desktop_files_regex/system", BM_read_desktop_files_regex, std::string(applications))->Unit(benchmark::kMillisecond);
+  }
+
+  int args_count = args.size();
+  benchmark::Initialize(&args_count, args.data());
+  if(benchmark::ReportUnrecognizedArguments(args_count, args.data()))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  std::error_code error;
+  std::filesystem::remove_all(data_path, error);
+  return 0;
+}
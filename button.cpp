@@ -18,18 +18,22 @@
 #include "utils.h"
 #include <glib.h>
 #include <iostream>
-#include <regex>
-#include "settings.h"
+#include "style.h"
+#include "stats.h"
 
 Button::Button() : PanelItem()
 {
   m_icon_ref = nullptr;
+  m_icon_cache = nullptr;
+  m_icon_cache_size = 0;
   init(std::string(), std::string());
 }
 
 Button::Button(const std::string & icon_path, const std::string & text) : PanelItem()
 {
   m_icon_ref = nullptr;
+  m_icon_cache = nullptr;
+  m_icon_cache_size = 0;
   init(icon_path, text);
 }
 
@@ -37,6 +41,7 @@ Button::~Button()
 {
   //cairo_surface_destroy(m_icon);
   //g_object_unref(m_svg_icon);
+  drop_caches();
   debug << "deleted" << std::endl;
 }
 
@@ -44,15 +49,81 @@ void Button::init(const std::string & icon_path, const std::string & text)
 {
   m_text = text;
   m_icon_ref = Icon::get_icon(icon_path);
+  drop_caches();
 }
 
-void Button::set_text(const std::string & text)
+void Button::drop_caches()
+{
+  if(m_icon_cache != nullptr) {
+    cairo_surface_destroy(m_icon_cache);
+    m_icon_cache = nullptr;
+  }
+}
+
+Button::IconCache::IconCache(IconCache && other)
+{
+  *this = std::move(other);
+}
+
+Button::IconCache & Button::IconCache::operator=(IconCache && other)
+{
+  if(this != &other) {
+    if(raster != nullptr)
+      cairo_surface_destroy(raster);
+    icon = std::move(other.icon);
+    text = std::move(other.text);
+    raster = other.raster;
+    raster_size = other.raster_size;
+    other.raster = nullptr;
+  }
+  return *this;
+}
+
+Button::IconCache::~IconCache()
+{
+  if(raster != nullptr)
+    cairo_surface_destroy(raster);
+}
+
+size_t Button::IconCache::bytes() const
+{
+  size_t size = sizeof(IconCache) + text.capacity();
+  if(icon != nullptr)
+    size += icon->bytes();
+  if(raster != nullptr)
+    size += raster_size * raster_size * 4;
+  return size;
+}
+
+Button::IconCache Button::take_icon_cache()
+{
+  IconCache cache;
+  cache.icon = m_icon_ref;
+  cache.text = m_text;
+  cache.raster = m_icon_cache;
+  cache.raster_size = m_icon_cache_size;
+  m_icon_cache = nullptr;
+  return cache;
+}
+
+void Button::set_icon_cache(IconCache && cache)
+{
+  drop_caches();
+  m_icon_ref = cache.icon;
+  m_text = cache.text;
+  m_icon_cache = cache.raster;
+  m_icon_cache_size = cache.raster_size;
+  cache.raster = nullptr;
+  m_need_repaint = true;
+}
+
+void Button::set_text(std::string_view text)
 {
   m_text = text;
   m_need_repaint = true;
 }
 
-std::string Button::get_text()
+const std::string & Button::get_text()
 {
   return m_text;
 }
@@ -73,23 +144,26 @@ std::string Button::get_icon()
     return std::string();
 }
 
-void Button::draw_text(cairo_t *cr, int x_offset, int y_offset, std::string text)
+void Button::draw_text(cairo_t *cr, int x_offset, int y_offset, const std::string & text)
 {
   int width, height = 0;
   int text_width = m_width - x_offset;
   int text_height = m_height - y_offset;
-  std::vector<std::string> lines = get_lines(text);
+  std::pmr::vector<const char *> lines = get_lines(text);
 
-  Color color = Settings::get_settings()->color();
-  cairo_set_source_rgba (cr, color.red, color.green, color.blue, 1.0);
-  cairo_select_font_face(cr, Settings::get_settings()->font().c_str(), CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-  cairo_set_font_size(cr, Settings::get_settings()->font_size());
-  for(std::string line : lines) {
-    cairo_text_extents_t extents;
-    cairo_text_extents(cr, line.c_str(), &extents);
-    if(text_width < extents.width)
-      text_width = extents.width + 6;
-    height += extents.height;
+  std::shared_ptr<const Style> style = Style::get_style();
+  cairo_set_source(cr, style->foreground());
+  cairo_set_scaled_font(cr, style->font());
+  {
+    static Latency *measure_latency = Stats::get_stats()->latency("text_measure");
+    ScopedLatency timer(measure_latency);
+    for(const char *line : lines) {
+      cairo_text_extents_t extents;
+      cairo_text_extents(cr, line, &extents);
+      if(text_width < extents.width)
+        text_width = extents.width + 6;
+      height += extents.height;
+    }
   }
 
   cairo_save(cr);
@@ -100,12 +174,12 @@ void Button::draw_text(cairo_t *cr, int x_offset, int y_offset, std::string text
   if(text_height > height)
     sep = (text_height - height) / (lines.size() + 1);
   int y = m_y + y_offset + sep;
-  for(std::string line : lines) {
+  for(const char *line : lines) {
     cairo_text_extents_t extents;
-    cairo_text_extents(cr, line.c_str(), &extents);
+    cairo_text_extents(cr, line, &extents);
     width = extents.width + 6;
     cairo_move_to(cr, m_x + x_offset + (text_width - width) / 2.0, y + extents.height);
-    cairo_show_text(cr, line.c_str());
+    cairo_show_text(cr, line);
     y += extents.height + sep;
   }
   cairo_restore(cr);
@@ -126,7 +200,19 @@ void Button::paint(cairo_t *cr)
   // Draws icon
   if(m_icon_ref != nullptr) {
     offset = (m_width > m_height ? m_height : m_width);
-    m_icon_ref->paint(cr, m_x, m_y, offset - 1, offset - 1);
+    // Icons are rendered once. Rendering SVG icons is slow.
+    if(m_icon_cache == nullptr || m_icon_cache_size != offset - 1) {
+      static Latency *render_latency = Stats::get_stats()->latency("icon_render");
+      ScopedLatency timer(render_latency);
+      drop_caches();
+      m_icon_cache_size = offset - 1;
+      m_icon_cache = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, m_icon_cache_size, m_icon_cache_size);
+      cairo_t *icon_cr = cairo_create(m_icon_cache);
+      m_icon_ref->paint(icon_cr, 0, 0, m_icon_cache_size, m_icon_cache_size);
+      cairo_destroy(icon_cr);
+    }
+    cairo_set_source_surface(cr, m_icon_cache, m_x, m_y);
+    cairo_paint(cr);
   }
 
   if(! m_text.empty())
@@ -144,15 +230,16 @@ void Button::update_size(cairo_t *cr)
     int text_width = 0;
     //int text_height = 0;
 
-    std::vector<std::string> lines = get_lines(m_text);
+    std::pmr::vector<const char *> lines = get_lines(m_text);
 
-    Color color = Settings::get_settings()->color();
-    cairo_set_source_rgba (cr, color.red, color.green, color.blue, 1.0);
-    cairo_select_font_face(cr, Settings::get_settings()->font().c_str(), CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-    cairo_set_font_size(cr, Settings::get_settings()->font_size());
-    for(std::string line : lines) {
+    std::shared_ptr<const Style> style = Style::get_style();
+    cairo_set_source(cr, style->foreground());
+    cairo_set_scaled_font(cr, style->font());
+    static Latency *measure_latency = Stats::get_stats()->latency("text_measure");
+    ScopedLatency timer(measure_latency);
+    for(const char *line : lines) {
       cairo_text_extents_t extents;
-      cairo_text_extents(cr, line.c_str(), &extents);
+      cairo_text_extents(cr, line, &extents);
       if(text_width < extents.width)
         text_width = extents.width + 6;
       //text_height += extents.height;
@@ -171,7 +258,7 @@ void Button::set_tooltip(const std::string & tooltip)
   m_tooltip = tooltip;
 }
 
-std::string Button::get_tooltip()
+const std::string & Button::get_tooltip()
 {
   return m_tooltip;
 }
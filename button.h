@@ -17,6 +17,7 @@
 #define __BUTTON_H__
 
 #include <string>
+#include <string_view>
 #include "panelitem.h"
 #include "icons.h"
 #include <librsvg/rsvg.h>
@@ -31,22 +32,58 @@ public:
   Button(const std::string & icon_path, const std::string & text);
   virtual ~Button();
 
-  void set_text(const std::string & text);
-  std::string get_text();
+  void set_text(std::string_view text);
+  const std::string & get_text();
   void set_icon(const std::string & icon_path);
   std::string get_icon();
   void set_tooltip(const std::string & tooltip);
-  std::string get_tooltip();
+  const std::string & get_tooltip();
 
   virtual void paint(cairo_t *cr) override;
   virtual void update_size(cairo_t *cr) override;
 
   virtual void mouse_enter() override;
+
+  /** Frees the rasterized icon. It is rendered again when button is painted.
+   *  Used when button isn't shown.
+   */
+  void drop_caches();
+
+  /*! \struct IconCache
+   *  \brief Icon, text and rasterized icon of a button.
+   *
+   *  Lets move the icon of a button to other button without loading
+   *  and rendering it again.
+   */
+  struct IconCache
+  {
+    std::shared_ptr<Icon> icon;
+    std::string text;
+    cairo_surface_t *raster = nullptr;
+    int raster_size = 0;
+
+    IconCache() = default;
+    IconCache(IconCache && other);
+    IconCache & operator=(IconCache && other);
+    ~IconCache();
+    /** Memory kept by the cache: rasterized icon, decoded icon and text. 
+     *  Decoded icons can be shared with other buttons, but they are counted,
+     *  as the cache keeps them loaded.
+     */
+    size_t bytes() const;
+  };
+  /** Moves icon and rasterized icon out of this button.
+   */
+  IconCache take_icon_cache();
+  void set_icon_cache(IconCache && cache);
 private:
   std::shared_ptr<Icon> m_icon_ref;
   std::string m_text, m_tooltip;
+  // Icon rendered at the size of the button
+  cairo_surface_t *m_icon_cache;
+  int m_icon_cache_size;
 
-  void draw_text(cairo_t *cr, int x_offset, int y_offset, std::string text);
+  void draw_text(cairo_t *cr, int x_offset, int y_offset, const std::string & text);
 
 protected:
   void init(const std::string & icon_path, const std::string & text);
@@ -15,10 +15,8 @@
   
 #include "debug.h"
 #include "buttonruncommand.h"
-#include <stdlib.h>
 #include <iostream>
-#include <sys/types.h>
-#include <sys/wait.h>
+#include <fcntl.h>
 #include <linux/input-event-codes.h>
 
 ButtonRunCommand::ButtonRunCommand() : Button() 
@@ -33,33 +31,33 @@ ButtonRunCommand::ButtonRunCommand(const std::string & icon_path, const std::str
 
 void ButtonRunCommand::set_command(const std::string & command)
 {
-  m_command = command;
+  m_command.set_command_line(command);
+}
+
+void ButtonRunCommand::set_persistent(bool persistent)
+{
+  if(persistent && !m_coprocess)
+    m_coprocess = std::make_shared<Coprocess>();
+  else if(!persistent)
+    m_coprocess = nullptr;
 }
 
 void ButtonRunCommand::set_fd(int fd)
 {
   m_fd = fd;
+  // Wayland connection must not be inherited by children
+  if(m_fd >= 0)
+    fcntl(m_fd, F_SETFD, fcntl(m_fd, F_GETFD) | FD_CLOEXEC);
 }
 
 void ButtonRunCommand::mouse_clicked(int button)
 {
   if(button == BTN_LEFT) {
-    debug << m_command  << " &>/dev/null &" << std::endl;
-    if(m_fd < 0) {
-      debug_error << "File descriptor has not been set. Use set_fd to set it." << std::endl;
-      return;
-    }
-    // Ignore child signals (no zombie process)
-    signal(SIGCHLD, SIG_IGN);
-    if(fork() == 0) {
-      close(m_fd);
-      system((m_command + " &> /dev/null &").c_str());
-      // Wait until child dies
-      int status;
-      wait(&status);
-      exit(0);
-    }
+    debug << m_command.get_command_line() << std::endl;
+    if(m_coprocess) {
+      if(!m_command.empty())
+        m_coprocess->send(m_command.get_shell_line());
+    } else
+      m_command.run();
   }
 }
-
-
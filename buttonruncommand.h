@@ -18,6 +18,9 @@
 
 #include <string>
 #include "button.h"
+#include "command.h"
+#include "coprocess.h"
+#include <memory>
 
 
 /*! \class ButtonRunCommand
@@ -31,7 +34,12 @@ public:
   ButtonRunCommand(const std::string & icon_path, const std::string & text, const std::string & tooltip);
 
   void set_command(const std::string & command);
+  /** If persistent is true, command is sent to a long-lived shell
+   * instead of launching a new process on each click.
+   */
+  void set_persistent(bool persistent);
   /** Set file descriptor from wayland wl_display.
+   * It is not inherited by launched commands.
    * Example:
    *  set_fd(display.get_fd());
    */
@@ -40,7 +48,8 @@ public:
   virtual void mouse_clicked(int button) override;
 
 private:
-  std::string m_command;
+  Command m_command;
+  std::shared_ptr<Coprocess> m_coprocess;
   int m_fd;
 };
 
@@ -15,30 +15,38 @@
   
 #include "debug.h"
 #include "clock.h"
+#include "allocations.h"
 #include <time.h>
-#include <vector>
+#include <string_view>
 
-static std::string get_time(std::string timeformat)
+#define TIME_SIZE 80
+
+/** Writes rawtime to buffer, which must have TIME_SIZE bytes.
+ */
+static std::string_view format_time(const char *timeformat, time_t rawtime, char *buffer)
 {
-  time_t rawtime;
-  struct tm *timeinfo;
-  char buffer[80];
+  struct tm timeinfo;
 
-  time(&rawtime);
-  timeinfo = localtime(&rawtime);
+  localtime_r(&rawtime, &timeinfo);
 
-  strftime(buffer, 80, timeformat.c_str(), timeinfo);
+  size_t size = strftime(buffer, TIME_SIZE, timeformat, &timeinfo);
 
-  return std::string(buffer);
+  return std::string_view(buffer, size);
+}
+
+static std::string get_time(const char *timeformat)
+{
+  char buffer[TIME_SIZE];
+  return std::string(format_time(timeformat, time(nullptr), buffer));
 }
 
 /** Clock is updated each minute. If contains seconds, it must be updated each second.
  */
 static int get_timeout_from_timeformat(const std::string &timeformat)
 {
-  std::vector<std::string> seconds_formats = {"%s", "%S", "%T"};
+  const char *seconds_formats[] = {"%s", "%S", "%T"};
   int timeout = 60000; // Update clock each 30 seconds
-  for(std::string item : seconds_formats)
+  for(const char *item : seconds_formats)
     if(timeformat.find(item) != std::string::npos)
       timeout = 1000;
   return timeout;
@@ -47,14 +55,19 @@ static int get_timeout_from_timeformat(const std::string &timeformat)
 Clock::Clock(const std::string & icon, const std::string & timeformat) : ButtonRunCommand(icon, std::string(), std::string()) 
 {
   m_timeformat = timeformat;
-  set_text(get_time(timeformat));
+  set_text(get_time(timeformat.c_str()));
   set_timeout(get_timeout_from_timeformat(timeformat));
   debug << "Time format: " << timeformat.c_str() << std::endl;
 }
 
 void Clock::timeout()
 {
-  std::string time = get_time(m_timeformat);
+  // Clock ticks don't allocate memory: text is formatted in the stack
+  // and m_text keeps its capacity when it is changed.
+  // Time of the timeout is used, so replayed ticks show recorded times.
+  ALLOCATION_AUDIT_SCOPE("Clock::timeout");
+  char buffer[TIME_SIZE];
+  std::string_view time = format_time(m_timeformat.c_str(), m_last_timeout / 1000, buffer);
   if(time != get_text()) {
     set_text(time);
     send_repaint();
@@ -0,0 +1,282 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "command.h"
+#include "eventloop.h"
+#include "stats.h"
+#include <spawn.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+extern char **environ;
+
+Command::Command()
+{
+  m_needs_shell = false;
+}
+
+Command::Command(const std::string & command_line)
+{
+  set_command_line(command_line);
+}
+
+void Command::set_command_line(const std::string & command_line)
+{
+  m_command_line = command_line;
+  m_argv.clear();
+  m_needs_shell = ! parse(command_line, m_argv);
+  if(m_needs_shell)
+    m_argv.clear();
+  debug << "Command " << command_line << (m_needs_shell ? " needs shell" : " runs without shell") << std::endl;
+}
+
+std::string Command::get_command_line()
+{
+  return m_command_line;
+}
+
+bool Command::empty()
+{
+  return m_argv.empty() && !m_needs_shell;
+}
+
+bool Command::needs_shell()
+{
+  return m_needs_shell;
+}
+
+const std::vector<std::string> & Command::get_argv()
+{
+  return m_argv;
+}
+
+std::string Command::get_shell_line()
+{
+  std::string line;
+  if(m_needs_shell) {
+    // Run by a subshell of the reading shell: there is no other exec of sh
+    // and the line can't change the reading shell
+    line = "( eval " + quote(m_command_line) + " )";
+  } else {
+    for(const std::string & arg : m_argv)
+      line += (line.empty() ? "" : " ") + quote(arg);
+  }
+  return line + " </dev/null";
+}
+
+std::string Command::quote(const std::string & text)
+{
+  // Single quotes can't be escaped inside single quotes: ' is written as '\''
+  std::string quoted = "'";
+  for(char ch : text) {
+    if(ch == '\'')
+      quoted += "'\\''";
+    else
+      quoted += ch;
+  }
+  return quoted + "'";
+}
+
+/** Field codes of desktop entries. Panel has not files or urls to pass, 
+ * so all of them are removed.
+ */
+static bool is_field_code(char ch)
+{
+  return strchr("fFuUdDnNvmikc", ch) != nullptr;
+}
+
+bool Command::parse(const std::string & command_line, std::vector<std::string> & argv)
+{
+  // Characters that must be quoted in desktop entries. If they are
+  // found outside quotes, command line is shell syntax.
+  const char *reserved = "\\><~|&;$*?#()`[]";
+  std::string arg;
+  bool in_arg = false;
+  size_t n = 0, size = command_line.size();
+
+  while(n < size) {
+    char ch = command_line[n];
+    if(ch == ' ' || ch == '\t' || ch == '\n') {
+      if(in_arg) {
+        argv.push_back(arg);
+        arg.clear();
+        in_arg = false;
+      }
+      n++;
+    } else if(ch == '"') {
+      // Double quoted: only ", `, $ and \ can be escaped
+      in_arg = true;
+      for(n++; n < size && command_line[n] != '"'; n++) {
+        ch = command_line[n];
+        if(ch == '\\' && n + 1 < size && strchr("\"`$\\", command_line[n + 1])) {
+          arg += command_line[++n];
+        } else if(ch == '`' || ch == '$') {
+          // Command substitution or variable
+          return false;
+        } else
+          arg += ch;
+      }
+      if(n >= size)
+        return false; // Unterminated quote
+      n++;
+    } else if(ch == '\'') {
+      // Single quoted text is literal, as in sh
+      in_arg = true;
+      for(n++; n < size && command_line[n] != '\''; n++)
+        arg += command_line[n];
+      if(n >= size)
+        return false;
+      n++;
+    } else if(ch == '%') {
+      if(n + 1 < size && command_line[n + 1] == '%') {
+        arg += '%';
+        in_arg = true;
+        n += 2;
+      } else if(n + 1 < size && is_field_code(command_line[n + 1])) {
+        n += 2;
+      } else {
+        // Not a field code, it is a literal "%" (example: "+5%")
+        arg += '%';
+        in_arg = true;
+        n++;
+      }
+    } else if(strchr(reserved, ch)) {
+      return false;
+    } else {
+      // "VAR=value command" is shell syntax
+      if(ch == '=' && argv.empty() && arg.find('/') == std::string::npos)
+        return false;
+      arg += ch;
+      in_arg = true;
+      n++;
+    }
+  }
+  if(in_arg)
+    argv.push_back(arg);
+
+  return true;
+}
+
+#ifdef SYS_pidfd_open
+static int pidfd_open(pid_t pid)
+{
+  return syscall(SYS_pidfd_open, pid, 0);
+}
+#else
+static int pidfd_open(pid_t pid)
+{
+  errno = ENOSYS;
+  return -1;
+}
+#endif
+
+/** Reaps child from main loop. If pidfds are not supported,
+ * children are reaped by kernel (SIGCHLD is ignored) and on_exit is not called.
+ */
+static void watch_child(pid_t pid, std::function<void(int status)> on_exit)
+{
+  int pidfd = pidfd_open(pid);
+  if(pidfd < 0) {
+    debug_error << "pidfd_open failed: " << strerror(errno) << ". Children will be reaped by kernel." << std::endl;
+    signal(SIGCHLD, SIG_IGN);
+    return;
+  }
+  EventLoop::add_fd(pidfd, POLLIN, [pid, pidfd, on_exit](short revents) {
+    int status = 0;
+    if(waitpid(pid, &status, WNOHANG) == 0)
+      return; // Child is still running
+    EventLoop::remove_fd(pidfd);
+    close(pidfd);
+    debug << "Child " << pid << " finished with status " << status << std::endl;
+    if(on_exit)
+      on_exit(status);
+  });
+}
+
+pid_t Command::run(int stdin_fd, int stdout_fd, std::function<void(int status)> on_exit)
+{
+  static Latency *launch_latency = Stats::get_stats()->latency("launch");
+  static uint64_t *launch_shell = Stats::get_stats()->counter("launch_shell");
+  static uint64_t *launch_direct = Stats::get_stats()->counter("launch_direct");
+
+  if(empty())
+    return -1;
+
+  uint64_t start = Stats::now_usecs();
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  if(stdin_fd >= 0)
+    posix_spawn_file_actions_adddup2(&actions, stdin_fd, STDIN_FILENO);
+  else
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+  if(stdout_fd >= 0)
+    posix_spawn_file_actions_adddup2(&actions, stdout_fd, STDOUT_FILENO);
+  else
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+  // Child only inherits standard input, output and error.
+  // Without closefrom, fds opened by panel must have O_CLOEXEC.
+  posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1);
+#endif
+
+  // Child gets default signal handlers and mask, and its own session
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t signals;
+  sigemptyset(&signals);
+  posix_spawnattr_setsigmask(&attr, &signals);
+  sigaddset(&signals, SIGCHLD);
+  sigaddset(&signals, SIGPIPE);
+  posix_spawnattr_setsigdefault(&attr, &signals);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSID);
+
+  pid_t pid = -1;
+  int error;
+  if(m_needs_shell) {
+    const char *argv[] = {"sh", "-c", m_command_line.c_str(), nullptr};
+    error = posix_spawn(&pid, "/bin/sh", &actions, &attr, (char* const*)argv, environ);
+    (*launch_shell)++;
+  } else {
+    std::vector<char*> argv;
+    for(const std::string & arg : m_argv)
+      argv.push_back((char*)arg.c_str());
+    argv.push_back(nullptr);
+    error = posix_spawnp(&pid, argv[0], &actions, &attr, argv.data(), environ);
+    (*launch_direct)++;
+  }
+
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+
+  if(error != 0) {
+    debug_error << "Command " << m_command_line << " cannot be run: " << strerror(error) << std::endl;
+    return -1;
+  }
+
+  launch_latency->record(Stats::now_usecs() - start);
+  debug << "Command " << m_command_line << " pid " << pid << std::endl;
+
+  watch_child(pid, on_exit);
+
+  return pid;
+}
@@ -0,0 +1,79 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __COMMAND_H__
+#define __COMMAND_H__
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <sys/types.h>
+
+/*! \class Command
+ *  \brief Command line run by launchers.
+ *
+ *  The command line is parsed once, using the quoting rules of the Exec key
+ *  of desktop entries. Field codes (%f, %U,...) are removed and "%%" is
+ *  changed to "%". The command is launched with posix_spawn and without a
+ *  shell, unless it needs shell syntax (pipes, redirections, variables,...).
+ *  In that case "/bin/sh -c command_line" is run.
+ *
+ *  Children only inherit standard input, output and error. They are reaped
+ *  from the main loop using pidfds.
+ *  Example:
+ *    Command command("pactl set-sink-volume @DEFAULT_SINK@ +5%");
+ *    command.run();
+ */
+class Command
+{
+public:
+  Command();
+  Command(const std::string & command_line);
+
+  void set_command_line(const std::string & command_line);
+  std::string get_command_line();
+  bool empty();
+  /** True if command line must be run by /bin/sh. */
+  bool needs_shell();
+  /** Arguments of the command. It is empty if needs_shell() is true. */
+  const std::vector<std::string> & get_argv();
+  /** Line that runs this command when it is read by /bin/sh. Arguments are
+   *  quoted, so it runs the same command as run(), and its standard input 
+   *  is /dev/null. Shell syntax is run by eval in a subshell, so a broken
+   *  command line (example: unterminated quote) only fails by itself.
+   */
+  std::string get_shell_line();
+
+  /** Runs the command.
+   * \param stdin_fd is used as standard input of child. If it is -1, /dev/null is used.
+   * \param stdout_fd is used as standard output of child. If it is -1, /dev/null is used.
+   * \param on_exit is called from main loop when child ends. The argument is waitpid status.
+   * \return pid of child or -1 if it cannot be launched.
+   */
+  pid_t run(int stdin_fd = -1, int stdout_fd = -1, std::function<void(int status)> on_exit = nullptr);
+
+  /** Parses command_line to argv. Returns false if command_line needs a shell.
+   */
+  static bool parse(const std::string & command_line, std::vector<std::string> & argv);
+  /** Quotes text as one argument of /bin/sh. */
+  static std::string quote(const std::string & text);
+
+private:
+  std::string m_command_line;
+  std::vector<std::string> m_argv;
+  bool m_needs_shell;
+};
+
+#endif
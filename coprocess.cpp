@@ -0,0 +1,112 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "coprocess.h"
+#include "stats.h"
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+struct CoprocessWorker
+{
+  int fd;    // Panel end of worker standard input
+  pid_t pid;
+};
+
+Coprocess::Coprocess() : m_shell("/bin/sh")
+{
+  m_worker = nullptr;
+}
+
+Coprocess::~Coprocess()
+{
+  stop();
+}
+
+bool Coprocess::start()
+{
+  int fds[2];
+  if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+    debug_error << "socketpair failed: " << strerror(errno) << std::endl;
+    return false;
+  }
+  // Worker can only read
+  shutdown(fds[0], SHUT_RD);
+  shutdown(fds[1], SHUT_WR);
+
+  auto worker = std::make_shared<CoprocessWorker>();
+  worker->fd = fds[0];
+  std::weak_ptr<CoprocessWorker> weak_worker = worker;
+  worker->pid = m_shell.run(fds[1], -1, [this, weak_worker](int status) {
+    // Worker has died. It will be restarted with next command.
+    auto worker = weak_worker.lock();
+    if(worker && worker == m_worker) {
+      debug << "Coprocess " << worker->pid << " finished" << std::endl;
+      stop();
+    }
+  });
+  close(fds[1]);
+
+  if(worker->pid < 0) {
+    close(worker->fd);
+    return false;
+  }
+  m_worker = worker;
+  debug << "Coprocess " << m_worker->pid << " started" << std::endl;
+  return true;
+}
+
+void Coprocess::stop()
+{
+  if(m_worker) {
+    // Shell exits when its standard input is closed
+    close(m_worker->fd);
+    m_worker = nullptr;
+  }
+}
+
+bool Coprocess::send(const std::string & command_line)
+{
+  static Latency *persistent_latency = Stats::get_stats()->latency("launch_persistent");
+  uint64_t start_time = Stats::now_usecs();
+  std::string line = command_line + "\n";
+
+  // If worker has died, it is restarted and command is sent again
+  for(int tries = 0; tries < 2; tries++) {
+    if(!m_worker && !start())
+      return false;
+    ssize_t size = ::send(m_worker->fd, line.c_str(), line.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    if(size == (ssize_t)line.size()) {
+      persistent_latency->record(Stats::now_usecs() - start_time);
+      return true;
+    }
+    if(size >= 0) {
+      // Only a part of the line has been sent. Worker is restarted
+      // in order to not run a broken command line.
+      debug_error << "Coprocess is busy. Command " << command_line << " has been dropped." << std::endl;
+      stop();
+      return false;
+    } else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+      // Worker is busy and its input is full. Don't block the panel.
+      debug_error << "Coprocess is busy. Command " << command_line << " has been dropped." << std::endl;
+      return false;
+    }
+    debug << "Coprocess send failed: " << strerror(errno) << std::endl;
+    stop();
+  }
+  return false;
+}
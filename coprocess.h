@@ -0,0 +1,58 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __COPROCESS_H__
+#define __COPROCESS_H__
+
+#include <string>
+#include <memory>
+#include "command.h"
+
+struct CoprocessWorker;
+
+/*! \class Coprocess
+ *  \brief Long-lived shell that runs command lines sent by panel.
+ *
+ *  The worker shell reads command lines from its standard input, which is
+ *  connected to the panel by a socket. The panel thread only pays a write:
+ *  the worker forks and execs each command asynchronously. Commands are run
+ *  one after another, so it is useful for short commands that are run many
+ *  times (example: change volume).
+ *  Lines must not read the standard input of the shell, which is the socket:
+ *  use Command::get_shell_line(). A command that keeps running blocks the 
+ *  next ones, unless it is run in background ("command &").
+ *  The worker is started on the first command and it is restarted if it dies.
+ *  Example:
+ *    Coprocess coprocess;
+ *    coprocess.send("pactl set-sink-volume @DEFAULT_SINK@ +5%");
+ */
+class Coprocess
+{
+public:
+  Coprocess();
+  virtual ~Coprocess();
+
+  /** Sends command line to worker. Returns false if it cannot be sent. */
+  bool send(const std::string & command_line);
+
+private:
+  bool start();
+  void stop();
+
+  std::shared_ptr<CoprocessWorker> m_worker;
+  Command m_shell;
+};
+
+#endif
@@ -2,16 +2,30 @@
 #define __DEBUG_H__
 
 #include <iostream>
+#include "logger.h"
 
 /*! A set of macros to debug messages.
+ *  Messages are written to stderr by the Logger thread:
+ *    debug << "Width " << width << std::endl;
+ *  debug messages are only saved with --debug. They are removed when 
+ *  compiling if LOG_MIN_LEVEL is greater than LOG_DEBUG.
+ *  Macros are a loop run once, not an if, so they can be used in an if
+ *  without braces and a following else isn't taken by the macro.
  */
 
-
-#define debug if(m_debug) std::cerr << "[" << __PRETTY_FUNCTION__ << "] Line:" << __LINE__ << "\t"
+#if LOG_MIN_LEVEL > LOG_DEBUG
+#define debug for(bool log_record_ = false; log_record_; log_record_ = false) LogRecord(LOG_DEBUG, __PRETTY_FUNCTION__, __LINE__)
+#else
+#define debug for(bool log_record_ = __builtin_expect(m_debug, 0) && Logger::allow(__PRETTY_FUNCTION__, __LINE__); log_record_; log_record_ = false) LogRecord(LOG_DEBUG, __PRETTY_FUNCTION__, __LINE__)
+#endif
 
 #define debug_get_func std::string("[") + std::string(__PRETTY_FUNCTION__) + std::string("]")
 
-#define debug_error std::cerr << "ERROR: [" << __PRETTY_FUNCTION__ << "] Line:" << __LINE__ << "\t"
+#if LOG_MIN_LEVEL > LOG_ERROR
+#define debug_error for(bool log_record_ = false; log_record_; log_record_ = false) LogRecord(LOG_ERROR, __PRETTY_FUNCTION__, __LINE__)
+#else
+#define debug_error for(bool log_record_ = Logger::allow(__PRETTY_FUNCTION__, __LINE__); log_record_; log_record_ = false) LogRecord(LOG_ERROR, __PRETTY_FUNCTION__, __LINE__)
+#endif
 
 
 extern bool m_debug;
@@ -0,0 +1,70 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "eventloop.h"
+#include "trace.h"
+#include <memory>
+#include <unordered_map>
+
+struct Watch
+{
+  short events;
+  EventLoop::Callback callback;
+};
+
+// Watches are shared_ptr: a callback can remove its own watch while it is running
+static std::unordered_map<int, std::shared_ptr<Watch> > watches;
+
+void EventLoop::add_fd(int fd, short events, Callback callback)
+{
+  if(fd < 0) {
+    debug_error << "Invalid file descriptor" << std::endl;
+    return;
+  }
+  auto watch = std::make_shared<Watch>();
+  watch->events = events;
+  watch->callback = callback;
+  watches[fd] = watch;
+}
+
+void EventLoop::remove_fd(int fd)
+{
+  watches.erase(fd);
+}
+
+void EventLoop::get_pollfds(std::vector<struct pollfd> & fds)
+{
+  for(auto & item : watches) {
+    struct pollfd fd;
+    fd.fd = item.first;
+    fd.events = item.second->events;
+    fd.revents = 0;
+    fds.push_back(fd);
+  }
+}
+
+void EventLoop::dispatch(const struct pollfd & fd)
+{
+  if(fd.revents == 0)
+    return;
+  auto item = watches.find(fd.fd);
+  if(item == watches.end())
+    return;
+  std::shared_ptr<Watch> watch = item->second;
+  TRACE_SCOPE("EventLoop::dispatch");
+  if(watch->callback)
+    watch->callback(fd.revents);
+}
@@ -0,0 +1,52 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __EVENTLOOP_H__
+#define __EVENTLOOP_H__
+
+#include <functional>
+#include <vector>
+#include <poll.h>
+
+/*! \class EventLoop
+ *  \brief File descriptors watched by the main loop.
+ *
+ *  Panel::run() polls the Wayland display and every file descriptor
+ *  added here. When a file descriptor has events, its callback is called
+ *  from the main loop.
+ *  Example:
+ *    EventLoop::add_fd(fd, POLLIN, [](short revents) { ... });
+ *    ...
+ *    EventLoop::remove_fd(fd);
+ */
+class EventLoop
+{
+public:
+  typedef std::function<void(short revents)> Callback;
+
+  /** Watches fd. events are poll events (POLLIN, POLLPRI,...).
+   * If fd is already watched, its events and callback are replaced.
+   */
+  static void add_fd(int fd, short events, Callback callback);
+  /** Stops watching fd. It can be called from fd callback. */
+  static void remove_fd(int fd);
+
+  /** Appends all watched file descriptors to fds. */
+  static void get_pollfds(std::vector<struct pollfd> & fds);
+  /** Calls the callback of fd.fd if fd.revents is not 0. */
+  static void dispatch(const struct pollfd & fd);
+};
+
+#endif
@@ -0,0 +1,146 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "eventrecorder.h"
+#include <sstream>
+#include <charconv>
+#include <locale>
+#include <stdlib.h>
+#include <time.h>
+
+bool EventRecorder::m_recording = false;
+
+EventRecorder *EventRecorder::get_recorder()
+{
+  static EventRecorder recorder;
+  return &recorder;
+}
+
+uint64_t EventRecorder::now_usecs()
+{
+  struct timespec time_aux;
+  clock_gettime(CLOCK_MONOTONIC, &time_aux);
+  return (uint64_t)time_aux.tv_sec * 1000000 + time_aux.tv_nsec / 1000;
+}
+
+void EventRecorder::start(const std::string & path)
+{
+  m_out.open(path);
+  if(!m_out) {
+    debug_error << "Events cannot be recorded to " << path << std::endl;
+    return;
+  }
+  // Recordings don't depend on the locale. Doubles are saved without
+  // losing precision, so pointer positions are replayed exactly.
+  m_out.imbue(std::locale::classic());
+  m_out.precision(17);
+  m_start_usecs = now_usecs();
+  m_recording = true;
+}
+
+void EventRecorder::flush()
+{
+  if(m_recording)
+    m_out.flush();
+}
+
+/** Spaces, '%' and control characters are saved as %XX. Empty strings are saved as "%".
+ */
+void EventRecorder::write_arg(const std::string & text)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  m_out << ' ';
+  if(text.empty())
+    m_out << '%';
+  for(unsigned char ch : text) {
+    if(ch <= ' ' || ch == '%' || ch == 0x7f)
+      m_out << '%' << hex[ch >> 4] << hex[ch & 0xf];
+    else
+      m_out << ch;
+  }
+}
+
+/** Numbers are parsed in the C locale, as they were written.
+ *  Returns 0 if text isn't a number.
+ */
+template<typename T> static T parse_number(const std::string & text)
+{
+  T value = 0;
+  std::from_chars(text.data(), text.data() + text.size(), value);
+  return value;
+}
+
+int RecordedEvent::get_int(size_t n) const
+{
+  return n < args.size() ? parse_number<int>(args[n]) : 0;
+}
+
+long RecordedEvent::get_long(size_t n) const
+{
+  return n < args.size() ? parse_number<long>(args[n]) : 0;
+}
+
+double RecordedEvent::get_double(size_t n) const
+{
+  return n < args.size() ? parse_number<double>(args[n]) : 0.0;
+}
+
+const std::string & RecordedEvent::get_string(size_t n) const
+{
+  static const std::string empty;
+  return n < args.size() ? args[n] : empty;
+}
+
+EventReader::EventReader(const std::string & path) : m_in(path)
+{
+}
+
+bool EventReader::is_open()
+{
+  return m_in.is_open();
+}
+
+static std::string unescape_arg(const std::string & text)
+{
+  if(text == "%")
+    return std::string();
+  std::string out;
+  out.reserve(text.size());
+  for(size_t n = 0; n < text.size(); n++) {
+    if(text[n] == '%' && n + 2 < text.size()) {
+      out.push_back((char)strtol(text.substr(n + 1, 2).c_str(), nullptr, 16));
+      n += 2;
+    } else
+      out.push_back(text[n]);
+  }
+  return out;
+}
+
+bool EventReader::next(RecordedEvent & event)
+{
+  while(std::getline(m_in, m_line)) {
+    std::istringstream in(m_line);
+    in.imbue(std::locale::classic());
+    std::string arg;
+    if(!(in >> event.usecs >> event.name))
+      continue;
+    event.args.clear();
+    while(in >> arg)
+      event.args.push_back(unescape_arg(arg));
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,98 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __EVENTRECORDER_H__
+#define __EVENTRECORDER_H__
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*! \class EventRecorder
+ *  \brief Saves Wayland events received by panel to a file (--record).
+ *
+ *  Each event is a line of text: time in microseconds since recording has 
+ *  been started, event name and arguments separated by spaces. Text 
+ *  arguments are escaped. Example:
+ *    1520 toplevel 3
+ *    1522 title 3 Mozilla%20Firefox
+ *    1530 done 3
+ *  Recorded events can be sent again to the panel with --replay (see 
+ *  Panel::replay).
+ */
+class EventRecorder
+{
+public:
+  static EventRecorder *get_recorder();
+
+  /** Starts recording to path. */
+  void start(const std::string & path);
+  /** Writes buffered events to the file. */
+  void flush();
+  static bool recording() { return m_recording; }
+
+  /** Saves an event. Arguments are numbers or strings. */
+  template<typename... Args> void record(const char *event, const Args &... args)
+  {
+    m_out << now_usecs() - m_start_usecs << ' ' << event;
+    (write_arg(args), ...);
+    m_out << '\n';
+  }
+
+private:
+  static uint64_t now_usecs();
+  void write_arg(const std::string & text);
+  void write_arg(const char *text) { write_arg(std::string(text)); }
+  template<typename T> void write_arg(const T & value) { m_out << ' ' << value; }
+
+  static bool m_recording;
+  std::ofstream m_out;
+  uint64_t m_start_usecs;
+};
+
+/*! \struct RecordedEvent
+ *  \brief Event read from a file saved by EventRecorder.
+ */
+struct RecordedEvent
+{
+  uint64_t usecs;
+  std::string name;
+  std::vector<std::string> args;
+
+  int get_int(size_t n) const;
+  long get_long(size_t n) const;
+  double get_double(size_t n) const;
+  const std::string & get_string(size_t n) const;
+};
+
+/*! \class EventReader
+ *  \brief Reads events saved by EventRecorder.
+ */
+class EventReader
+{
+public:
+  EventReader(const std::string & path);
+
+  bool is_open();
+  /** Reads next event. Returns false at the end of file. */
+  bool next(RecordedEvent & event);
+
+private:
+  std::ifstream m_in;
+  std::string m_line;
+};
+
+#endif
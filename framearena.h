@@ -0,0 +1,58 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __FRAMEARENA_H__
+#define __FRAMEARENA_H__
+
+#include <memory_resource>
+#include <string_view>
+#include <stddef.h>
+
+#define FRAME_ARENA_SIZE (64 * 1024)
+
+/*! \class FrameArena
+ *  \brief Memory for temporary data of a frame.
+ *
+ *  Memory is taken from a fixed buffer and it is freed at once when the 
+ *  frame is finished (see Panel::run), so painting doesn't call operator 
+ *  new. If a frame needs more than FRAME_ARENA_SIZE bytes, the rest is 
+ *  allocated with operator new.
+ *  Only used from the main thread.
+ *
+ *  Example:
+ *    std::pmr::vector<int> sizes(FrameArena::get_arena()->resource());
+ */
+class FrameArena
+{
+public:
+  static FrameArena *get_arena();
+  FrameArena();
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  std::pmr::memory_resource *resource() { return &m_resource; }
+  /** Copy of text ended with '\0', so it can be given to C functions.
+   */
+  const char *c_str(std::string_view text);
+  /** Frees all the memory of the frame.
+   */
+  void reset();
+
+private:
+  alignas(std::max_align_t) char m_buffer[FRAME_ARENA_SIZE];
+  std::pmr::monotonic_buffer_resource m_resource;
+};
+
+#endif
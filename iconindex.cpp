@@ -0,0 +1,179 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "iconindex.h"
+#include "eventloop.h"
+#include "stats.h"
+#include "trace.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <exception>
+
+IconIndex *IconIndex::get_index()
+{
+  static IconIndex index;
+  return &index;
+}
+
+IconIndex::IconIndex() : m_next_task(0), m_pending_tasks(0)
+{
+  m_event_fd = -1;
+  m_ready = false;
+  m_start_usecs = 0;
+}
+
+IconIndex::~IconIndex()
+{
+  for(std::thread & thread : m_threads) {
+    if(thread.joinable())
+      thread.join();
+  }
+  if(m_event_fd >= 0)
+    close(m_event_fd);
+}
+
+void IconIndex::add_task(std::function<void(IconIndexPartial &)> task)
+{
+  m_tasks.push_back(task);
+}
+
+void IconIndex::start(unsigned max_threads)
+{
+  if(m_tasks.empty() || !m_threads.empty())
+    return;
+
+  m_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if(m_event_fd < 0) {
+    debug_error << "eventfd cannot be created. Icons will be searched in disk." << std::endl;
+    return;
+  }
+  EventLoop::add_fd(m_event_fd, POLLIN, [this](short revents) {
+    uint64_t value;
+    if(read(m_event_fd, &value, sizeof(value)) != sizeof(value))
+      return;
+    finish();
+  });
+
+  m_start_usecs = Stats::now_usecs();
+  m_partials.resize(m_tasks.size());
+  m_pending_tasks = m_tasks.size();
+  unsigned threads = std::thread::hardware_concurrency();
+  if(threads == 0 || threads > max_threads)
+    threads = max_threads;
+  if(threads > m_tasks.size())
+    threads = m_tasks.size();
+  debug << "Indexing icons: " << m_tasks.size() << " tasks, " << threads << " threads" << std::endl;
+  for(unsigned n = 0; n < threads; n++)
+    m_threads.emplace_back(&IconIndex::worker, this);
+}
+
+void IconIndex::worker()
+{
+  for(size_t task = m_next_task++; task < m_tasks.size(); task = m_next_task++) {
+    try {
+      TRACE_SCOPE("IconIndex::task");
+      m_tasks[task](m_partials[task]);
+    } catch(const std::exception & e) {
+      // Results of the other tasks are still merged
+      debug_error << "Icon index task failed: " << e.what() << std::endl;
+    }
+    if(--m_pending_tasks > 0)
+      continue;
+
+    // Last task merges results
+    for(IconIndexPartial & partial : m_partials) {
+      for(auto & item : partial.icons)
+        m_index.icons.emplace(std::move(item.first), std::move(item.second));
+      for(auto & item : partial.execs)
+        m_index.execs.emplace(std::move(item.first), std::move(item.second));
+    }
+    m_partials.clear();
+    uint64_t value = 1;
+    if(write(m_event_fd, &value, sizeof(value)) != sizeof(value))
+      debug_error << "eventfd cannot be written" << std::endl;
+  }
+}
+
+void IconIndex::wait()
+{
+  if(m_threads.empty())
+    return;
+  struct pollfd fd = {m_event_fd, POLLIN, 0};
+  while(poll(&fd, 1, -1) < 0 && errno == EINTR);
+  EventLoop::dispatch(fd);
+}
+
+/** Runs in main thread when all tasks are finished.
+ */
+void IconIndex::finish()
+{
+  static Latency *index_latency = Stats::get_stats()->latency("icon_index");
+  index_latency->record(Stats::now_usecs() - m_start_usecs);
+  for(std::thread & thread : m_threads)
+    thread.join();
+  m_threads.clear();
+  m_tasks.clear();
+  EventLoop::remove_fd(m_event_fd);
+  close(m_event_fd);
+  m_event_fd = -1;
+  m_ready = true;
+  debug << "Icon index ready: " << m_index.icons.size() << " icons, " << m_index.execs.size() << " desktop files" << std::endl;
+  if(on_ready)
+    on_ready();
+}
+
+void IconIndex::reset()
+{
+  // Workers don't take more tasks
+  m_next_task = m_tasks.size();
+  for(std::thread & thread : m_threads)
+    thread.join();
+  m_threads.clear();
+  if(m_event_fd >= 0) {
+    EventLoop::remove_fd(m_event_fd);
+    close(m_event_fd);
+    m_event_fd = -1;
+  }
+  m_tasks.clear();
+  m_partials.clear();
+  m_index = IconIndexPartial();
+  m_next_task = 0;
+  m_pending_tasks = 0;
+  m_ready = false;
+}
+
+bool IconIndex::ready()
+{
+  return m_ready;
+}
+
+const std::string *IconIndex::find_icon(const std::string & name)
+{
+  if(!m_ready)
+    return nullptr;
+  auto item = m_index.icons.find(name);
+  return item == m_index.icons.end() ? nullptr : &item->second;
+}
+
+const std::string *IconIndex::find_exec(const std::string & exec)
+{
+  if(!m_ready)
+    return nullptr;
+  auto item = m_index.execs.find(exec);
+  return item == m_index.execs.end() ? nullptr : &item->second;
+}
@@ -0,0 +1,103 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ICONINDEX_H__
+#define __ICONINDEX_H__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <stdint.h>
+
+/*! \struct IconIndexPartial
+ *  \brief Result of a task of IconIndex.
+ *
+ *  icons maps icon names to paths. execs maps executables of desktop
+ *  files to icon names.
+ */
+struct IconIndexPartial
+{
+  std::unordered_map<std::string, std::string> icons;
+  std::unordered_map<std::string, std::string> execs;
+};
+
+/*! \class IconIndex
+ *  \brief Index of icons and desktop files built at start up by worker threads.
+ *
+ *  Each task scans a directory tree and fills its own IconIndexPartial, so
+ *  threads don't share data while they work. The last task merges partial
+ *  results, in the order tasks were added: an entry of the first task is
+ *  preferred over entries of the next ones.
+ *  When index is finished, the main thread is woken by an eventfd in
+ *  EventLoop. Until then, ready() returns false and callers must search
+ *  icons in disk.
+ *
+ *  Example:
+ *    IconIndex *index = IconIndex::get_index();
+ *    index->add_task([](IconIndexPartial & partial) {...});
+ *    index->start();
+ *    ...
+ *    if(index->ready()) index->find_icon("firefox");
+ */
+class IconIndex
+{
+public:
+  static IconIndex *get_index();
+  IconIndex();
+  ~IconIndex();
+
+  void add_task(std::function<void(IconIndexPartial &)> task);
+  /** Runs tasks using up to max_threads threads.
+   */
+  void start(unsigned max_threads = 4);
+  /** Forgets the index, so tasks can be added and started again.
+   *  Tasks which are running are waited for.
+   */
+  void reset();
+  bool ready();
+  /** Blocks main thread until index is finished. 
+   */
+  void wait();
+
+  /** Path of icon. Returns nullptr if index isn't ready or icon isn't found.
+   */
+  const std::string *find_icon(const std::string & name);
+  /** Icon of executable. Returns nullptr if index isn't ready or exec isn't found.
+   */
+  const std::string *find_exec(const std::string & exec);
+
+  /** Called from main thread when index is ready.
+   */
+  std::function<void()> on_ready;
+
+private:
+  void worker();
+  void finish();
+
+  std::vector<std::function<void(IconIndexPartial &)> > m_tasks;
+  std::vector<IconIndexPartial> m_partials;
+  std::vector<std::thread> m_threads;
+  std::atomic<size_t> m_next_task;
+  std::atomic<size_t> m_pending_tasks;
+  int m_event_fd;
+  bool m_ready;
+  uint64_t m_start_usecs;
+  IconIndexPartial m_index;
+};
+
+#endif
@@ -15,16 +15,21 @@
   
 #include "debug.h"
 #include "icons.h"
-#include <regex>
 #include <glib.h>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <vector>
+#include <algorithm>
 #include <filesystem>
 #include <stdlib.h>
 #include "settings.h"
+#include "inifile.h"
+#include "stats.h"
+#include "trace.h"
 
 std::unordered_map<std::string, std::weak_ptr<Icon> > Icon::icons;
+std::list<std::shared_ptr<Icon> > Icon::recent_icons;
+size_t Icon::recent_icons_bytes = 0;
+size_t Icon::recent_icons_max_bytes = 4 * 1024 * 1024;
 
 /** Gets size from icon path. Icons paths are "8x8/", "32x32/", "scalable",...
  * This function tries to get size from path. If path is "8x8", it will return 8.
@@ -60,33 +65,32 @@ struct Sort_path_compare
   }
 };
 
-struct Index_theme_file {
-  std::vector<std::string> paths;
-  std::vector<std::string> parent_themes;
-};
-
-static Index_theme_file read_index_theme_paths(const std::string & path, int panel_size)
+Index_theme_file read_index_theme_paths(const std::string & path, int panel_size)
 {
   std::vector<std::string> paths, parents;
   std::vector<int> sizes;
 
-  std::regex re_directories("^Directories=.*"), re_parents("^Inherits=.*");
-
   debug << "Reading " << path + "/index.theme" << std::endl;
-  std::ifstream in(path + "/index.theme");
-  for(std::string line; std::getline(in, line); ) {
-    if(std::regex_match(line, re_directories)) {
-      std::stringstream buff(line.substr(12));
-      std::string item;
-      while(getline(buff, item, ',')) {
-        paths.push_back(item);
-      }
-    } else if(std::regex_match(line, re_parents)) {
-      std::stringstream buff(line.substr(9));
-      std::string item;
-      while(getline(buff, item, ',')) {
-        parents.push_back(item);
-      }
+  IniFile in(path + "/index.theme");
+  std::string_view group, key, value;
+  while(in.next(group, key, value)) {
+    if(group != "Icon Theme")
+      continue;
+    std::vector<std::string> *list = nullptr;
+    if(key == "Directories")
+      list = &paths;
+    else if(key == "Inherits")
+      list = &parents;
+    else
+      continue;
+    while(!value.empty()) {
+      size_t comma = value.find(',');
+      std::string_view item = value.substr(0, comma);
+      if(!item.empty())
+        list->push_back(std::string(item));
+      if(comma == std::string_view::npos)
+        break;
+      value.remove_prefix(comma + 1);
     }
   }
 
@@ -104,14 +108,15 @@ static Index_theme_file read_index_theme_paths(const std::string & path, int pan
 static std::vector<std::string> categories_from_theme_path(const std::string & path, int panel_size)
 {
   std::vector<std::string> categories;
-  if(std::filesystem::directory_entry(path).exists()) {
-    for(std::filesystem::directory_entry entry : std::filesystem::directory_iterator(path)) {
-      if(entry.is_directory()) {
-        std::string category_str = entry.path().filename().string();
-        categories.push_back(category_str);
-        for(std::string category : categories_from_theme_path(entry.path().string(), panel_size)) {
-          categories.push_back(category_str + "/" + category);
-        }
+  // It runs in threads of IconIndex: unreadable directories are skipped
+  std::error_code error;
+  for(const std::filesystem::directory_entry & entry : std::filesystem::directory_iterator(path, error)) {
+    std::error_code entry_error;
+    if(entry.is_directory(entry_error)) {
+      std::string category_str = entry.path().filename().string();
+      categories.push_back(category_str);
+      for(std::string category : categories_from_theme_path(entry.path().string(), panel_size)) {
+        categories.push_back(category_str + "/" + category);
       }
     }
   }
@@ -123,9 +128,13 @@ static std::vector<std::string> categories_from_theme_path(const std::string & p
   return categories;
 }
 
-static std::string get_icon_for_theme(const std::string & path, const std::string & theme, const std::string & icon_name, int panel_size)
+static std::string get_icon_for_theme(const std::string & path, const std::string & theme, const std::string & icon_name, int panel_size, std::vector<std::string> & visited)
 {
   debug << "path " << path << " theme " << theme << " icon " << icon_name << " panel_size " << panel_size << std::endl;
+  // Themes can inherit each other
+  if(std::find(visited.begin(), visited.end(), theme) != visited.end())
+    return std::string();
+  visited.push_back(theme);
   std::vector<std::string> formats = {".png", ".svg"};
   Index_theme_file index_theme;
   if(theme == "hicolor")
@@ -146,7 +155,7 @@ static std::string get_icon_for_theme(const std::string & path, const std::strin
 
   debug << "Icon " << icon_name << " not found. Checking parent theme." << std::endl;
   for(std::string theme : index_theme.parent_themes) {
-    std::string icon = get_icon_for_theme(path, theme, icon_name, panel_size);
+    std::string icon = get_icon_for_theme(path, theme, icon_name, panel_size, visited);
     if(!icon.empty())
       return icon;
   }
@@ -156,6 +165,70 @@ static std::string get_icon_for_theme(const std::string & path, const std::strin
   return std::string();
 }
 
+/** Saves all icons of theme in the order used by get_icon_for_theme.
+ *  Icons already saved aren't changed.
+ */
+static void add_theme_to_index(const std::string & path, const std::string & theme, int panel_size, IconIndexPartial & partial, std::vector<std::string> & visited)
+{
+  if(std::find(visited.begin(), visited.end(), theme) != visited.end())
+    return;
+  visited.push_back(theme);
+  Index_theme_file index_theme;
+  if(theme == "hicolor")
+    index_theme.paths = categories_from_theme_path(path + "/" + theme, panel_size);
+  else
+    index_theme = read_index_theme_paths(path + "/" + theme, panel_size);
+
+  std::vector<std::filesystem::path> svg_icons;
+  for(const std::string & category : index_theme.paths) {
+    std::string dir = path + "/" + theme + "/" + category + "/";
+    std::error_code error;
+    svg_icons.clear();
+    // png icons are preferred
+    for(const std::filesystem::directory_entry & entry : std::filesystem::directory_iterator(dir, error)) {
+      std::string file = entry.path().filename().string();
+      if(has_extension(file, ".png"))
+        partial.icons.emplace(file.substr(0, file.size() - 4), dir + file);
+      else if(has_extension(file, ".svg"))
+        svg_icons.push_back(entry.path().filename());
+    }
+    for(const std::filesystem::path & file : svg_icons) {
+      std::string name = file.string();
+      partial.icons.emplace(name.substr(0, name.size() - 4), dir + name);
+    }
+  }
+
+  for(const std::string & parent : index_theme.parent_themes)
+    add_theme_to_index(path, parent, panel_size, partial, visited);
+}
+
+/** Paths of icon themes
+ */
+static std::vector<std::string> get_icon_theme_paths()
+{
+  std::vector<std::string> icon_theme_paths;
+  icon_theme_paths.push_back(Settings::home_path() + "/.icons/");
+  icon_theme_paths.push_back(Settings::get_env("XDG_DATA_HOME") + "/");
+  icon_theme_paths.push_back("/usr/share/icons/");
+  icon_theme_paths.push_back("/usr/local/share/icons/");
+  return icon_theme_paths;
+}
+
+void Icon::add_index_tasks(IconIndex *index)
+{
+  Settings *settings = Settings::get_settings();
+  int panel_size = settings->panel_size();
+  std::vector<std::string> themes = {settings->icon_theme(), "hicolor"};
+  for(const std::string & icon_theme_path : get_icon_theme_paths()) {
+    for(const std::string & theme : themes) {
+      index->add_task([icon_theme_path, theme, panel_size](IconIndexPartial & partial) {
+        std::vector<std::string> visited;
+        add_theme_to_index(icon_theme_path, theme, panel_size, partial, visited);
+      });
+    }
+  }
+}
+
 std::string Icon::suggested_icon_for_id(std::string id)
 {
   {
@@ -165,6 +238,12 @@ std::string Icon::suggested_icon_for_id(std::string id)
       return id;
   }
 
+  IconIndex *index = IconIndex::get_index();
+  if(index->ready()) {
+    const std::string *icon = index->find_icon(id);
+    return icon != nullptr ? *icon : std::string();
+  }
+
   // Change id of icon to lower case (icons are saved as lower case files)
   //for(char &ch : id) {ch = std::tolower(ch);}
   std::string icon;
@@ -172,11 +251,7 @@ std::string Icon::suggested_icon_for_id(std::string id)
   debug << "suggested_icon_for_id " << id << " " << id + std::string("\\.(png|svg)$") << std::endl;
   
   // Paths of icon themes
-  std::vector<std::string> icon_theme_paths;
-  icon_theme_paths.push_back(Settings::home_path() + "/.icons/");
-  icon_theme_paths.push_back(Settings::get_env("XDG_DATA_HOME") + "/");
-  icon_theme_paths.push_back("/usr/share/icons/");
-  icon_theme_paths.push_back("/usr/local/share/icons/");
+  std::vector<std::string> icon_theme_paths = get_icon_theme_paths();
   
   // Icons sizes
   int panel_size = settings->panel_size();
@@ -189,7 +264,8 @@ std::string Icon::suggested_icon_for_id(std::string id)
   // Checks if icon exists in icon themes  
   for(std::string icon_theme_path : icon_theme_paths) {
     for(std::string theme : themes) {
-      std::string icon = get_icon_for_theme(icon_theme_path, theme, id, panel_size);
+      std::vector<std::string> visited;
+      std::string icon = get_icon_for_theme(icon_theme_path, theme, id, panel_size, visited);
       if(!icon.empty())
         return icon;
     }
@@ -202,25 +278,85 @@ std::string Icon::suggested_icon_for_id(std::string id)
 
 std::shared_ptr<Icon> Icon::get_icon(const std::string & path)
 {
+  static uint64_t *hits = Stats::get_stats()->counter("icon_cache_hits");
+  static uint64_t *misses = Stats::get_stats()->counter("icon_cache_misses");
   debug << path << std::endl;
   if(path.empty())
     return nullptr;
 
+  std::shared_ptr<Icon> icon;
   auto item = icons.find(path);
-  if(item == icons.end()) {
+  if(item != icons.end())
+    icon = item->second.lock();
+  if(icon == nullptr) {
     // Icon not found create a new one
+    (*misses)++;
     std::string icon_path = suggested_icon_for_id(path);
     if(icon_path.empty())
       return nullptr;
     // Add icon to icons map
-    auto icon = std::make_shared<Icon>(path, icon_path);
+    icon = std::make_shared<Icon>(path, icon_path);
     icons[path] = icon;
-    return icon;
-  } else {
-      return item->second.lock();
+  } else
+    (*hits)++;
+  touch(icon);
+  return icon;
+}
+
+/** Moves icon to the front of recently used icons. Least recently used
+ *  icons are released if they use more than recent_icons_max_bytes.
+ */
+void Icon::touch(const std::shared_ptr<Icon> & icon)
+{
+  static uint64_t *evictions = Stats::get_stats()->counter("icon_cache_evictions");
+  static int64_t *bytes = Stats::get_stats()->gauge("icon_cache_bytes");
+  static int64_t *count = Stats::get_stats()->gauge("icon_cache_icons");
+
+  if(icon->m_recent)
+    recent_icons.splice(recent_icons.begin(), recent_icons, icon->m_recent_pos);
+  else {
+    recent_icons.push_front(icon);
+    icon->m_recent_pos = recent_icons.begin();
+    icon->m_recent = true;
+    recent_icons_bytes += icon->m_bytes;
+  }
+
+  while(recent_icons_bytes > recent_icons_max_bytes && !recent_icons.empty()) {
+    std::shared_ptr<Icon> last = recent_icons.back();
+    debug << "Icon " << last->m_path << " released from cache" << std::endl;
+    last->m_recent = false;
+    recent_icons_bytes -= last->m_bytes;
+    recent_icons.pop_back();
+    (*evictions)++;
+  }
+  *bytes = recent_icons_bytes;
+  *count = recent_icons.size();
+}
+
+void Icon::set_cache_size(size_t bytes)
+{
+  recent_icons_max_bytes = bytes;
+  while(recent_icons_bytes > recent_icons_max_bytes && !recent_icons.empty()) {
+    recent_icons.back()->m_recent = false;
+    recent_icons_bytes -= recent_icons.back()->m_bytes;
+    recent_icons.pop_back();
   }
 }
 
+void Icon::clear_cache()
+{
+  for(const std::shared_ptr<Icon> & icon : recent_icons)
+    icon->m_recent = false;
+  recent_icons.clear();
+  recent_icons_bytes = 0;
+  icons.clear();
+}
+
+size_t Icon::bytes()
+{
+  return m_bytes;
+}
+
 std::string Icon::get_icon_path()
 {
   return m_icon_path;
@@ -229,19 +365,24 @@ std::string Icon::get_icon_path()
 Icon::Icon(const std::string & path, const std::string & icon_path)
 {
   m_ref_count = 0;
+  m_bytes = 0;
+  m_recent = false;
   m_path = path;
   m_icon_path = icon_path;
   m_icon = nullptr;
   m_svg_icon = nullptr;
   if(!m_icon_path.empty()) {
+    static Latency *decode_latency = Stats::get_stats()->latency("icon_decode");
+    ScopedLatency timer(decode_latency);
     std::string str(m_icon_path);
-    if(std::regex_match(str, std::regex(".*\\.[Pp][Nn][Gg]"))) {
+    if(has_extension(str, ".png")) {
       m_icon = cairo_image_surface_create_from_png (m_icon_path.c_str());
       if(m_icon != nullptr) {
         m_icon_width = cairo_image_surface_get_width(m_icon);
         m_icon_height = cairo_image_surface_get_height(m_icon);
+        m_bytes = cairo_image_surface_get_stride(m_icon) * m_icon_height;
       }
-    } else if(std::regex_match(str, std::regex(".*\\.[Ss][Vv][Gg]"))) {
+    } else if(has_extension(str, ".svg")) {
       GError *error = nullptr;
       m_svg_icon = rsvg_handle_new_from_file(m_icon_path.c_str(), &error);
       if(!m_svg_icon) {
@@ -249,26 +390,32 @@ Icon::Icon(const std::string & path, const std::string & icon_path)
         g_clear_error(&error);
         exit(1);
       }
+      std::error_code error_code;
+      m_bytes = std::filesystem::file_size(m_icon_path, error_code);
+      if(error_code)
+        m_bytes = 0;
     }
   }
 }
 
 Icon::~Icon()
 {
-  // Delete icon from icons list
+  // Delete icon from icons list. After clear_cache, the entry can be
+  // a new icon with the same name.
   auto item = icons.find(m_path);
-  if(item != icons.end()) icons.erase(item);
+  if(item != icons.end() && item->second.expired()) icons.erase(item);
 
   // Release cairo objects
   cairo_surface_destroy(m_icon);
   g_object_unref(m_svg_icon);
   m_icon = nullptr;
   m_svg_icon = nullptr;
-  debug << "Icon " << m_path << " deleted." << std::endl;
+  // Not logged: icons in static caches are deleted after the logger
 }
 
 void Icon::paint(cairo_t *cr, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
 {
+  TRACE_SCOPE("Icon::paint");
   debug << " Start painting Icon " << m_path << " Path: " << m_icon_path << std::endl;
   // Draws icon
   if(m_icon != nullptr) {
@@ -17,10 +17,26 @@
 #define __ICONS_H__
 
 #include <string>
+#include <vector>
 #include <cairo/cairo.h>
 #include <librsvg/rsvg.h>
 #include <memory>
 #include <unordered_map>
+#include <list>
+#include "iconindex.h"
+
+/*! \struct Index_theme_file
+ *  \brief Directories and parent themes of an icon theme.
+ */
+struct Index_theme_file {
+  std::vector<std::string> paths;
+  std::vector<std::string> parent_themes;
+};
+
+/** Reads index.theme of the theme in path. Directories are sorted by
+ *  distance of their icon size to panel_size.
+ */
+Index_theme_file read_index_theme_paths(const std::string & path, int panel_size);
 
 /*! \class Icon
  *  \brief Icon to draw in a cairo surface.
@@ -28,6 +44,8 @@
  *  A icon from icons resources are loaded with get_icon method
  *  and can be paint with paint method.
  *  Icons are stored in a map and are they reused.
+ *  Recently used icons are kept loaded, up to set_cache_size bytes, 
+ *  so they aren't loaded from disk again when they are used again.
  */
 class Icon
 {
@@ -52,6 +70,20 @@ public:
    */
   static std::shared_ptr<Icon> get_icon(const std::string & path);
   static std::string suggested_icon_for_id(std::string id);
+  /** Adds tasks to index icon themes. One task for each themes path.
+   */
+  static void add_index_tasks(IconIndex *index);
+
+  /** Memory used by the decoded icon. For SVG icons, size of file is used.
+   */
+  size_t bytes();
+  /** Sets memory used by recently used icons.
+   */
+  static void set_cache_size(size_t bytes);
+  /** Forgets loaded icons, so they are searched again.
+   *  Icons in use are kept alive by their owners.
+   */
+  static void clear_cache();
 
 private:
   cairo_surface_t *m_icon;
@@ -60,9 +92,17 @@ private:
   std::string m_path; // Icon id name
   std::string m_icon_path;
   uint32_t m_ref_count;
+  size_t m_bytes;
 
   // Map of all loaded icons
   static std::unordered_map<std::string, std::weak_ptr<Icon> > icons;
+
+  // Recently used icons, most recent first
+  static std::list<std::shared_ptr<Icon> > recent_icons;
+  static size_t recent_icons_bytes, recent_icons_max_bytes;
+  bool m_recent;
+  std::list<std::shared_ptr<Icon> >::iterator m_recent_pos;
+  static void touch(const std::shared_ptr<Icon> & icon);
 };
 
 #endif
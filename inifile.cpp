@@ -0,0 +1,113 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "inifile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctype.h>
+
+static std::string_view trim(std::string_view text)
+{
+  while(!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+    text.remove_prefix(1);
+  while(!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+    text.remove_suffix(1);
+  return text;
+}
+
+IniFile::IniFile(const std::string & path)
+{
+  m_data = nullptr;
+  m_size = m_pos = 0;
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd < 0)
+    return;
+  struct stat st;
+  if(fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data != MAP_FAILED) {
+      m_data = (const char*)data;
+      m_size = st.st_size;
+    }
+  }
+  close(fd);
+}
+
+IniFile::~IniFile()
+{
+  if(m_data != nullptr)
+    munmap((void*)m_data, m_size);
+}
+
+bool IniFile::is_open()
+{
+  return m_data != nullptr;
+}
+
+bool IniFile::next(std::string_view & group, std::string_view & key, std::string_view & value)
+{
+  while(m_pos < m_size) {
+    std::string_view line(m_data + m_pos, m_size - m_pos);
+    size_t end = line.find('\n');
+    if(end == std::string_view::npos)
+      end = line.size();
+    m_pos += end + 1;
+    line = trim(line.substr(0, end));
+
+    if(line.empty() || line.front() == '#')
+      continue;
+    if(line.front() == '[') {
+      size_t close = line.find(']');
+      if(close != std::string_view::npos)
+        m_group = line.substr(1, close - 1);
+      continue;
+    }
+    size_t equal = line.find('=');
+    if(equal == std::string_view::npos)
+      continue;
+    group = m_group;
+    key = trim(line.substr(0, equal));
+    value = trim(line.substr(equal + 1));
+    return true;
+  }
+  return false;
+}
+
+std::string_view IniFile::get(std::string_view group, std::string_view key)
+{
+  m_pos = 0;
+  m_group = std::string_view();
+  std::string_view entry_group, entry_key, value;
+  while(next(entry_group, entry_key, value)) {
+    if(entry_group == group && entry_key == key)
+      return value;
+  }
+  return std::string_view();
+}
+
+bool has_extension(std::string_view path, std::string_view extension)
+{
+  if(path.size() < extension.size())
+    return false;
+  path.remove_prefix(path.size() - extension.size());
+  for(size_t n = 0; n < path.size(); n++) {
+    if(tolower((unsigned char)path[n]) != tolower((unsigned char)extension[n]))
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,67 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INIFILE_H__
+#define __INIFILE_H__
+
+#include <string>
+#include <string_view>
+
+/*! \class IniFile
+ *  \brief Reads files with the format of desktop entries and index.theme.
+ *
+ *  File is mapped in memory and read without copies. Returned
+ *  groups, keys and values point to the mapped file, so they are valid
+ *  while IniFile exists.
+ *  Comments, empty lines and lines without '=' are skipped. Spaces around
+ *  '=' are removed. Localized keys, like "Name[es]", are returned as they are.
+ *
+ *  Example:
+ *    IniFile file("/usr/share/applications/firefox.desktop");
+ *    std::string_view group, key, value;
+ *    while(file.next(group, key, value)) {
+ *      if(group == "Desktop Entry" && key == "Icon")
+ *        ...
+ *    }
+ */
+class IniFile
+{
+public:
+  IniFile(const std::string & path);
+  ~IniFile();
+  IniFile(const IniFile&) = delete;
+  IniFile& operator=(const IniFile&) = delete;
+
+  bool is_open();
+
+  /** Reads next entry. Returns false at the end of file.
+   */
+  bool next(std::string_view & group, std::string_view & key, std::string_view & value);
+
+  /** Value of key in group. Returns empty string if key isn't found.
+   */
+  std::string_view get(std::string_view group, std::string_view key);
+
+private:
+  const char *m_data;
+  size_t m_size;
+  size_t m_pos;
+  std::string_view m_group;
+};
+
+// Returns true if path ends with extension. Case is ignored. Example: has_extension(path, ".png")
+bool has_extension(std::string_view path, std::string_view extension);
+
+#endif
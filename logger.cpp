@@ -0,0 +1,446 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "logger.h"
+#include <algorithm>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/eventfd.h>
+
+#define LOG_RATE_SLOTS 512
+
+static uint64_t log_now_usecs()
+{
+  struct timespec time_aux;
+  clock_gettime(CLOCK_MONOTONIC, &time_aux);
+  return (uint64_t)time_aux.tv_sec * 1000000 + time_aux.tv_nsec / 1000;
+}
+
+LogRecord::LogRecord(int level, const char *function, int line)
+{
+  m_level = level;
+  m_function = function;
+  m_line = line;
+  m_size = 0;
+  m_truncated = false;
+}
+
+LogRecord::~LogRecord()
+{
+  Logger::get_logger()->push(m_level, m_function, m_line, m_data, m_size, m_truncated);
+}
+
+bool LogRecord::reserve(size_t size)
+{
+  if(m_size + size > LOG_RECORD_DATA_SIZE) {
+    m_truncated = true;
+    return false;
+  }
+  return true;
+}
+
+void LogRecord::add_integer(char type, uint64_t value)
+{
+  if(!reserve(1 + sizeof(value)))
+    return;
+  m_data[m_size] = type;
+  memcpy(m_data + m_size + 1, &value, sizeof(value));
+  m_size += 1 + sizeof(value);
+}
+
+LogRecord & LogRecord::operator<<(const char *text)
+{
+  return *this << std::string_view(text == nullptr ? "(null)" : text);
+}
+
+LogRecord & LogRecord::operator<<(std::string_view text)
+{
+  // Text is cut if it doesn't fit
+  if(!reserve(4))
+    return *this;
+  uint16_t length = std::min(text.size(), LOG_RECORD_DATA_SIZE - m_size - 3);
+  if(length < text.size())
+    m_truncated = true;
+  m_data[m_size] = 's';
+  memcpy(m_data + m_size + 1, &length, sizeof(length));
+  memcpy(m_data + m_size + 3, text.data(), length);
+  m_size += 3 + length;
+  return *this;
+}
+
+LogRecord & LogRecord::operator<<(char value)
+{
+  if(reserve(2)) {
+    m_data[m_size++] = 'c';
+    m_data[m_size++] = value;
+  }
+  return *this;
+}
+
+LogRecord & LogRecord::operator<<(bool value)
+{
+  if(reserve(2)) {
+    m_data[m_size++] = 'b';
+    m_data[m_size++] = value;
+  }
+  return *this;
+}
+
+LogRecord & LogRecord::operator<<(double value)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  add_integer('f', bits);
+  return *this;
+}
+
+LogRecord & LogRecord::operator<<(std::ostream & (*manipulator)(std::ostream &))
+{
+  if(manipulator == static_cast<std::ostream & (*)(std::ostream &)>(std::endl))
+    *this << '\n';
+  return *this;
+}
+
+Logger *Logger::get_logger()
+{
+  static Logger logger;
+  return &logger;
+}
+
+Logger::Logger() : m_head(0), m_dropped(0), m_running(false), m_sleeping(false)
+{
+  m_tail = 0;
+  m_dropped_written = 0;
+  for(Slot & slot : m_ring)
+    slot.seq.store(0, std::memory_order_relaxed);
+  m_event_fd = eventfd(0, EFD_CLOEXEC);
+}
+
+Logger::~Logger()
+{
+  stop();
+  if(m_event_fd >= 0)
+    close(m_event_fd);
+}
+
+void Logger::start()
+{
+  if(m_thread.joinable() || m_event_fd < 0)
+    return;
+  m_running = true;
+  m_thread = std::thread([this]() {
+    // Signals are handled by main thread
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    writer();
+  });
+}
+
+void Logger::stop()
+{
+  if(m_thread.joinable()) {
+    m_running = false;
+    uint64_t value = 1;
+    if(::write(m_event_fd, &value, sizeof(value)) != sizeof(value)) {
+      m_thread.detach();
+      return;
+    }
+    m_thread.join();
+  } else
+    writer();
+}
+
+/** Counts records of each line of code in the current second. Lines which 
+ *  share a counter share the limit.
+ */
+bool Logger::allow(const char *function, int line)
+{
+  struct RateSlot 
+  {
+    std::atomic<uint64_t> second;
+    std::atomic<uint32_t> count;
+  };
+  static RateSlot slots[LOG_RATE_SLOTS];
+
+  RateSlot & slot = slots[(((uintptr_t)function >> 4) ^ (line * 31)) % LOG_RATE_SLOTS];
+  uint64_t second = log_now_usecs() / 1000000;
+  if(slot.second.load(std::memory_order_relaxed) != second) {
+    slot.second.store(second, std::memory_order_relaxed);
+    slot.count.store(0, std::memory_order_relaxed);
+  }
+  if(slot.count.fetch_add(1, std::memory_order_relaxed) < LOG_RATE_LIMIT)
+    return true;
+  get_logger()->m_dropped.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void Logger::push(int level, const char *function, int line, const char *data, size_t size, bool truncated)
+{
+  uint64_t words[LOG_RECORD_WORDS] = {0};
+  words[0] = log_now_usecs();
+  words[1] = (uintptr_t)function;
+  words[2] = (uint32_t)line | (uint64_t)(level & 0xff) << 32 | (uint64_t)size << 40 | (uint64_t)truncated << 56;
+  memcpy(words + LOG_RECORD_HEADER_WORDS, data, size);
+  size_t n_words = LOG_RECORD_HEADER_WORDS + (size + 7) / 8;
+
+  uint64_t index = m_head.fetch_add(1);
+  Slot & slot = m_ring[index & (LOG_RING_SIZE - 1)];
+  slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for(size_t n = 0; n < n_words; n++)
+    slot.words[n].store(words[n], std::memory_order_relaxed);
+  slot.seq.store(2 * index + 2);
+
+  // Writer is only woken if it is waiting
+  if(m_sleeping.load() && m_sleeping.exchange(false)) {
+    uint64_t value = 1;
+    if(::write(m_event_fd, &value, sizeof(value)) != sizeof(value))
+      return;
+  }
+}
+
+/** Copies a record of the ring. Writers can be overwriting it, then 
+ *  OVERWRITTEN is returned.
+ */
+Logger::ReadResult Logger::read(uint64_t index, uint64_t *words)
+{
+  Slot & slot = m_ring[index & (LOG_RING_SIZE - 1)];
+  uint64_t seq = slot.seq.load(std::memory_order_acquire);
+  if(seq < 2 * index + 2)
+    return ReadResult::NOT_READY;
+  if(seq > 2 * index + 2)
+    return ReadResult::OVERWRITTEN;
+  words[2] = slot.words[2].load(std::memory_order_relaxed);
+  size_t size = (words[2] >> 40) & 0xffff;
+  size_t n_words = LOG_RECORD_HEADER_WORDS + (std::min(size, (size_t)LOG_RECORD_DATA_SIZE) + 7) / 8;
+  for(size_t n = 0; n < n_words; n++)
+    words[n] = slot.words[n].load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(slot.seq.load(std::memory_order_relaxed) != seq)
+    return ReadResult::OVERWRITTEN;
+  return ReadResult::READY;
+}
+
+/** Writes records until the ring is empty and the logger is stopped.
+ *  Several records are written to stderr in each write().
+ */
+void Logger::writer()
+{
+  char buffer[8192];
+  size_t used = 0;
+  uint64_t lost = 0;
+  uint64_t words[LOG_RECORD_WORDS];
+
+  auto flush = [&]() {
+    size_t written = 0;
+    while(written < used) {
+      ssize_t n = ::write(STDERR_FILENO, buffer + written, used - written);
+      if(n <= 0)
+        break;
+      written += n;
+    }
+    used = 0;
+  };
+
+  while(true) {
+    ReadResult result = read(m_tail, words);
+    if(result == ReadResult::NOT_READY) {
+      uint64_t now_dropped = m_dropped.load(std::memory_order_relaxed);
+      if(now_dropped != m_dropped_written || lost > 0) {
+        std::string text = "Logger: " + std::to_string(now_dropped - m_dropped_written) + " records dropped by rate limit, " 
+          + std::to_string(lost) + " records lost\n";
+        m_dropped_written = now_dropped;
+        lost = 0;
+        flush();
+        memcpy(buffer, text.data(), std::min(text.size(), sizeof(buffer)));
+        used = std::min(text.size(), sizeof(buffer));
+      }
+      flush();
+      if(!m_running)
+        break;
+      m_sleeping = true;
+      if(read(m_tail, words) == ReadResult::NOT_READY && m_running) {
+        uint64_t value;
+        if(::read(m_event_fd, &value, sizeof(value)) != sizeof(value))
+          break;
+      }
+      m_sleeping = false;
+      continue;
+    }
+    if(result == ReadResult::OVERWRITTEN) {
+      // Writer is too slow, oldest records are skipped
+      uint64_t head = m_head.load();
+      uint64_t next = head > LOG_RING_SIZE ? head - LOG_RING_SIZE + 1 : m_tail + 1;
+      if(next <= m_tail)
+        next = m_tail + 1;
+      lost += next - m_tail;
+      m_tail = next;
+      continue;
+    }
+    m_tail++;
+    if(sizeof(buffer) - used < 1024)
+      flush();
+    used += format(words, buffer + used, sizeof(buffer) - used);
+  }
+}
+
+/** Text functions used by format. They don't allocate memory, 
+ *  so they can be used in a signal handler.
+ */
+static void append_text(char *out, size_t size, size_t & used, const char *text, size_t length)
+{
+  if(length > size - used)
+    length = size - used;
+  memcpy(out + used, text, length);
+  used += length;
+}
+
+static void append_text(char *out, size_t size, size_t & used, const char *text)
+{
+  append_text(out, size, used, text, strlen(text));
+}
+
+static void append_uint(char *out, size_t size, size_t & used, uint64_t value)
+{
+  char digits[24];
+  int n = sizeof(digits);
+  do {
+    digits[--n] = '0' + value % 10;
+    value /= 10;
+  } while(value > 0);
+  append_text(out, size, used, digits + n, sizeof(digits) - n);
+}
+
+static void append_double(char *out, size_t size, size_t & used, double value)
+{
+  if(value != value) {
+    append_text(out, size, used, "nan");
+    return;
+  }
+  if(value < 0) {
+    append_text(out, size, used, "-");
+    value = -value;
+  }
+  if(value > 1e18) {
+    append_text(out, size, used, "inf");
+    return;
+  }
+  // Up to 6 decimals, like std::ostream
+  uint64_t integer = value;
+  uint64_t decimals = (value - integer) * 1000000 + 0.5;
+  if(decimals >= 1000000) {
+    integer++;
+    decimals -= 1000000;
+  }
+  append_uint(out, size, used, integer);
+  if(decimals > 0) {
+    char digits[8] = ".000000";
+    for(int n = 6; n > 0; n--, decimals /= 10)
+      digits[n] = '0' + decimals % 10;
+    int length = 7;
+    while(digits[length - 1] == '0')
+      length--;
+    append_text(out, size, used, digits, length);
+  }
+}
+
+size_t Logger::format(const uint64_t *words, char *out, size_t size)
+{
+  size_t used = 0;
+  const char *function = (const char *)(uintptr_t)words[1];
+  uint32_t line = words[2] & 0xffffffff;
+  int level = (words[2] >> 32) & 0xff;
+  size_t data_size = std::min((size_t)((words[2] >> 40) & 0xffff), (size_t)LOG_RECORD_DATA_SIZE);
+  bool truncated = (words[2] >> 56) & 1;
+  const char *data = (const char *)(words + LOG_RECORD_HEADER_WORDS);
+
+  if(level >= LOG_ERROR)
+    append_text(out, size, used, "ERROR: ");
+  append_text(out, size, used, "[");
+  append_text(out, size, used, function);
+  append_text(out, size, used, "] Line:");
+  append_uint(out, size, used, line);
+  append_text(out, size, used, "\t");
+  for(size_t n = 0; n < data_size;) {
+    char type = data[n++];
+    uint64_t value = 0;
+    uint16_t length = 0;
+    switch(type) {
+      case 'i': case 'u': case 'f':
+        if(n + sizeof(value) > data_size)
+          return used;
+        memcpy(&value, data + n, sizeof(value));
+        n += sizeof(value);
+        if(type == 'u')
+          append_uint(out, size, used, value);
+        else if(type == 'i') {
+          if((int64_t)value < 0) {
+            append_text(out, size, used, "-");
+            value = -value;
+          }
+          append_uint(out, size, used, value);
+        } else {
+          double number;
+          memcpy(&number, &value, sizeof(number));
+          append_double(out, size, used, number);
+        }
+        break;
+      case 's':
+        if(n + sizeof(length) > data_size)
+          return used;
+        memcpy(&length, data + n, sizeof(length));
+        n += sizeof(length);
+        if(n + length > data_size)
+          length = data_size - n;
+        append_text(out, size, used, data + n, length);
+        n += length;
+        break;
+      case 'c':
+        append_text(out, size, used, data + n, 1);
+        n++;
+        break;
+      case 'b':
+        append_text(out, size, used, data[n] ? "1" : "0");
+        n++;
+        break;
+      default:
+        return used;
+    }
+  }
+  if(truncated)
+    append_text(out, size, used, "...\n");
+  return used;
+}
+
+void Logger::dump_recent(int fd)
+{
+  char buffer[1024];
+  uint64_t words[LOG_RECORD_WORDS];
+  uint64_t head = m_head.load();
+  uint64_t index = head > LOG_FLIGHT_RECORDS ? head - LOG_FLIGHT_RECORDS : 0;
+  const char header[] = "Last log records:\n";
+  if(::write(fd, header, sizeof(header) - 1) < 0)
+    return;
+  for(; index < head; index++) {
+    if(read(index, words) != ReadResult::READY)
+      continue;
+    size_t used = format(words, buffer, sizeof(buffer));
+    if(::write(fd, buffer, used) < 0)
+      return;
+  }
+}
@@ -0,0 +1,151 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __LOGGER_H__
+#define __LOGGER_H__
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <type_traits>
+#include <stdint.h>
+
+#define LOG_DEBUG 0
+#define LOG_ERROR 1
+
+// Records with a lower level are removed when compiling.
+// Example: cmake -DLOG_MIN_LEVEL=1 ..
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_DEBUG
+#endif
+
+#define LOG_RING_SIZE 4096 // It must be a power of two
+#define LOG_RECORD_WORDS 32
+#define LOG_RECORD_HEADER_WORDS 3
+#define LOG_RECORD_DATA_SIZE ((LOG_RECORD_WORDS - LOG_RECORD_HEADER_WORDS) * 8)
+#define LOG_RATE_LIMIT 200 // Records per second from each line of code
+#define LOG_FLIGHT_RECORDS 64 // Records written when panel crashes
+
+/*! \class LogRecord
+ *  \brief Log message which is being built. 
+ *
+ *  Values are saved in binary format and they are formatted by the 
+ *  logger thread. The record is sent to the logger when it is destroyed,
+ *  at the end of the line which creates it. Use the debug and debug_error
+ *  macros of debug.h instead of this class.
+ */
+class LogRecord
+{
+public:
+  LogRecord(int level, const char *function, int line);
+  ~LogRecord();
+  LogRecord(const LogRecord&) = delete;
+  LogRecord& operator=(const LogRecord&) = delete;
+
+  LogRecord & operator<<(const char *text);
+  LogRecord & operator<<(std::string_view text);
+  LogRecord & operator<<(char value);
+  LogRecord & operator<<(bool value);
+  LogRecord & operator<<(double value);
+  /** Only std::endl is supported. Other manipulators are ignored. */
+  LogRecord & operator<<(std::ostream & (*manipulator)(std::ostream &));
+
+  template<typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+  LogRecord & operator<<(T value)
+  {
+    if(std::is_signed_v<T>)
+      add_integer('i', (uint64_t)(int64_t)value);
+    else
+      add_integer('u', (uint64_t)value);
+    return *this;
+  }
+
+  /** Other types are formatted with their operator<<(std::ostream &). */
+  template<typename T, std::enable_if_t<!std::is_arithmetic_v<T> && !std::is_convertible_v<const T &, std::string_view>, int> = 0>
+  LogRecord & operator<<(const T & value)
+  {
+    std::ostringstream out;
+    out << value;
+    return *this << std::string_view(out.str());
+  }
+
+private:
+  void add_integer(char type, uint64_t value);
+  bool reserve(size_t size);
+
+  int m_level;
+  const char *m_function;
+  int m_line;
+  size_t m_size;
+  bool m_truncated;
+  char m_data[LOG_RECORD_DATA_SIZE];
+};
+
+/*! \class Logger
+ *  \brief Writes log records to stderr from its own thread.
+ *
+ *  Records are saved in a lock-free ring buffer of LOG_RING_SIZE records. 
+ *  The ring keeps the last records after they are written, so they are
+ *  written again as a flight recorder if panel crashes.
+ *  Each line of code can send LOG_RATE_LIMIT records per second, the rest
+ *  are dropped.
+ */
+class Logger
+{
+public:
+  static Logger *get_logger();
+  Logger();
+  ~Logger();
+
+  /** Starts the thread which writes records. Records sent before are kept. */
+  void start();
+  /** Writes pending records and stops the thread. */
+  void stop();
+
+  /** Returns false if the line of code has sent too many records. */
+  static bool allow(const char *function, int line);
+  /** Saves a record in the ring. It can be called from any thread. */
+  void push(int level, const char *function, int line, const char *data, size_t size, bool truncated);
+  /** Writes the last records to fd. It can be called from a signal handler. */
+  void dump_recent(int fd);
+
+private:
+  struct Slot
+  {
+    // 2*index+1 while record is being written, 2*index+2 when it is ready
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> words[LOG_RECORD_WORDS];
+  };
+
+  enum class ReadResult {READY, NOT_READY, OVERWRITTEN};
+
+  ReadResult read(uint64_t index, uint64_t *words);
+  void writer();
+  static size_t format(const uint64_t *words, char *out, size_t size);
+
+  Slot m_ring[LOG_RING_SIZE];
+  std::atomic<uint64_t> m_head; // Number of records sent
+  uint64_t m_tail; // Next record to write. Only used by writer.
+  std::atomic<uint64_t> m_dropped; // Records dropped by rate limit
+  uint64_t m_dropped_written; // Dropped records already reported. Only used by writer.
+  std::atomic<bool> m_running;
+  std::atomic<bool> m_sleeping;
+  int m_event_fd;
+  std::thread m_thread;
+};
+
+#endif
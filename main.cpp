@@ -16,30 +16,56 @@
 #include "debug.h"
 #include "panel.h"
 #include "settings.h"
+#include "stats.h"
+#include "trace.h"
+#include "eventrecorder.h"
+#include "iconindex.h"
 #include "configure.h"
 #include <string.h>
 #include <iostream>
 #include <filesystem>
 #include <execinfo.h>
 #include <locale.h>
+#include <signal.h>
 
 void printstacktrace(int sig)
 {
   void *array[10];
   size_t size;
 
+  // Last log records show what panel was doing
+  Logger::get_logger()->dump_recent(STDERR_FILENO);
+
   // get void*'s for all entries on the stack
   size = backtrace(array, 10);
 
   // print out all the frames to stderr
   backtrace_symbols_fd(array, size, STDERR_FILENO);
+
+  if(sig != 0) {
+    // Default action ends panel
+    signal(sig, SIG_DFL);
+    raise(sig);
+  }
 }
 
 void print_help(char *cmd)
 {
-  std::cout << cmd << R"( [--debug] [--settings file] [--help]
+  std::cout << cmd << R"( [--debug] [--stats] [--trace file] [--record file] [--replay file [--realtime]] [--settings file] [--help]
   This a simple taskbar for Wayland. It needs layer-shell and foreign-toplevel Wayland protocols.
   --debug shows debug output.
+  --stats shows counters and latencies when panel exits.
+    Stats are also sent to SIGUSR1 (written to stderr) and to clients of
+    $XDG_RUNTIME_DIR/yatbfw.sock (OpenMetrics text format).
+  --trace file saves a Chrome trace (chrome://tracing, ui.perfetto.dev) to
+    "file" when panel exits or receives SIGUSR2.
+  --record file saves Wayland events received by panel to "file".
+  --replay file sends events saved with --record to a panel which is drawn
+    in memory, without Wayland compositor, and shows CPU time, frames and
+    allocations. Events are sent as fast as possible, unless --realtime is
+    given. Timers of items only run when their timeouts have been recorded.
+    If panel is built with 
+    -DALLOCATION_AUDIT=ON, exit status is 1 when partial repaints allocate memory.
   --help shows this help.
   --settings file loads settings from "file" instead from ~/config/yatbfw.json
 
@@ -52,9 +78,21 @@ int main(int argn, char *argv[])
   setlocale(LC_ALL, "");
   
   signal(SIGSEGV, printstacktrace);
-  Panel panel;
+  Logger::get_logger()->start();
+
+  // Replayed events don't need a Wayland compositor
+  const char *replay_path = nullptr;
+  bool realtime = false;
+  for(int i = 1; i < argn; i++) {
+    if(argn > (i+1) && !strcmp(argv[i], "--replay"))
+      replay_path = argv[++i];
+    else if(!strcmp(argv[i], "--realtime"))
+      realtime = true;
+  }
+  Panel panel(replay_path != nullptr);
 
   Settings *settings = Settings::get_settings();
+  bool show_stats = false;
 
   {
     // Parse command line
@@ -66,6 +104,14 @@ int main(int argn, char *argv[])
         settings_file = true;
       } else if(!strcmp(argv[i], "--debug")) {
         m_debug = true;
+      } else if(argn > (i+1) && !strcmp(argv[i], "--trace")) {
+        Trace::get_trace()->start(argv[++i]);
+      } else if(argn > (i+1) && !strcmp(argv[i], "--record")) {
+        EventRecorder::get_recorder()->start(argv[++i]);
+      } else if(argn > (i+1) && !strcmp(argv[i], "--replay")) {
+        i++;
+      } else if(!strcmp(argv[i], "--stats")) {
+        show_stats = true;
       } else if(!strcmp(argv[i], "--help")) {
         print_help(argv[0]);
         return 0;
@@ -88,14 +134,36 @@ int main(int argn, char *argv[])
     }
   }
 
+  // Signals are blocked before starting threads
+  Stats::get_stats()->start_server();
+
+  // Icon themes and desktop files are indexed while panel starts
+  // Windows shown while panel starts can have the wrong icon
+  IconIndex::get_index()->on_ready = [&panel]() {
+    panel.update_toplevel_icons();
+  };
+  panel.rebuild_icon_index();
+
+  int status = 0;
   try {
-    panel.init();
-    // Run events loop
-    panel.run();
+    if(replay_path != nullptr) {
+      if(!panel.replay(replay_path, realtime))
+        status = 1;
+    } else {
+      panel.init();
+      // Run events loop
+      panel.run();
+    }
   } catch(const std::exception& e) {
     std::cerr << "Exception launched:" << std::endl;
     std::cerr << e.what() << std::endl;
     printstacktrace(0);
   }
-  return 0;
+  if(show_stats)
+    Stats::get_stats()->dump(std::cerr);
+  if(m_trace)
+    Trace::get_trace()->write();
+  EventRecorder::get_recorder()->flush();
+  Logger::get_logger()->stop();
+  return status;
 }
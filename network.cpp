@@ -0,0 +1,279 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "network.h"
+#include "eventloop.h"
+#include "stats.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+static uint64_t read_counter(const std::string & path)
+{
+  char buffer[32];
+  uint64_t value = 0;
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd < 0)
+    return 0;
+  ssize_t size = pread(fd, buffer, sizeof(buffer) - 1, 0);
+  close(fd);
+  if(size > 0) {
+    buffer[size] = '\0';
+    value = strtoull(buffer, nullptr, 10);
+  }
+  return value;
+}
+
+static std::string format_rate(uint64_t bytes_per_second)
+{
+  if(bytes_per_second >= 1024 * 1024)
+    return std::to_string(bytes_per_second / (1024 * 1024)) + " MiB/s";
+  else if(bytes_per_second >= 1024)
+    return std::to_string(bytes_per_second / 1024) + " KiB/s";
+  return std::to_string(bytes_per_second) + " B/s";
+}
+
+Network::Network(
+   const std::string & icon_wireless,
+   const std::string & icon_wired,
+   const std::string & icon_offline
+) : ButtonRunCommand()
+{
+  m_icon_wireless = icon_wireless;
+  m_icon_wired    = icon_wired;
+  m_icon_offline  = icon_offline;
+  m_seq = 0;
+  m_dump = 0;
+  m_tooltip_visible = false;
+  m_last_sample = 0;
+
+  m_icon = m_icon_offline;
+  set_icon(m_icon);
+
+  m_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+  if(m_fd < 0) {
+    debug_error << "Netlink socket cannot be opened: " << strerror(errno) << std::endl;
+    return;
+  }
+  struct sockaddr_nl addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+  if(bind(m_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    debug_error << "Netlink socket cannot be bound: " << strerror(errno) << std::endl;
+    close(m_fd);
+    m_fd = -1;
+    return;
+  }
+  EventLoop::add_fd(m_fd, POLLIN, [this](short revents) {
+    read_netlink();
+  });
+
+  // Initial state: links are read first, then addresses
+  request_dump(RTM_GETLINK);
+}
+
+Network::~Network()
+{
+  if(m_fd >= 0) {
+    EventLoop::remove_fd(m_fd);
+    close(m_fd);
+  }
+}
+
+void Network::request_dump(int type)
+{
+  struct {
+    struct nlmsghdr header;
+    struct rtgenmsg message;
+  } request;
+  memset(&request, 0, sizeof(request));
+  request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtgenmsg));
+  request.header.nlmsg_type = type;
+  request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  request.header.nlmsg_seq = ++m_seq;
+  request.message.rtgen_family = AF_UNSPEC;
+  if(send(m_fd, &request, request.header.nlmsg_len, 0) < 0) {
+    debug_error << "Netlink request failed: " << strerror(errno) << std::endl;
+    m_dump = 0;
+  } else
+    m_dump = type;
+}
+
+void Network::read_netlink()
+{
+  // Netlink messages are aligned to 4 bytes
+  alignas(struct nlmsghdr) char buffer[8192];
+  ssize_t size;
+  bool changed = false;
+
+  while((size = recv(m_fd, buffer, sizeof(buffer), 0)) > 0) {
+    for(struct nlmsghdr *header = (struct nlmsghdr*)buffer; NLMSG_OK(header, size); header = NLMSG_NEXT(header, size)) {
+      switch(header->nlmsg_type) {
+        case NLMSG_DONE:
+          if(m_dump == RTM_GETLINK)
+            request_dump(RTM_GETADDR);
+          else
+            m_dump = 0;
+          break;
+        case NLMSG_ERROR:
+          debug << "Netlink error message" << std::endl;
+          m_dump = 0;
+          break;
+        case RTM_NEWLINK:
+        case RTM_DELLINK: {
+          struct ifinfomsg *info = (struct ifinfomsg*)NLMSG_DATA(header);
+          if(header->nlmsg_type == RTM_DELLINK) {
+            m_interfaces.erase(info->ifi_index);
+            changed = true;
+            break;
+          }
+          Interface & interface = m_interfaces[info->ifi_index];
+          int length = IFLA_PAYLOAD(header);
+          for(struct rtattr *attr = IFLA_RTA(info); RTA_OK(attr, length); attr = RTA_NEXT(attr, length)) {
+            if(attr->rta_type == IFLA_IFNAME && interface.name.empty()) {
+              interface.name = (const char*)RTA_DATA(attr);
+              interface.wireless = access(("/sys/class/net/" + interface.name + "/wireless").c_str(), F_OK) == 0;
+            }
+          }
+          interface.up = (info->ifi_flags & IFF_UP) && (info->ifi_flags & IFF_RUNNING);
+          interface.loopback = info->ifi_flags & IFF_LOOPBACK;
+          changed = true;
+          break;
+        }
+        case RTM_NEWADDR:
+        case RTM_DELADDR: {
+          struct ifaddrmsg *info = (struct ifaddrmsg*)NLMSG_DATA(header);
+          if(info->ifa_scope != RT_SCOPE_UNIVERSE && info->ifa_scope != RT_SCOPE_SITE)
+            break; // Link-local and host addresses don't give connectivity
+          int length = IFA_PAYLOAD(header);
+          for(struct rtattr *attr = IFA_RTA(info); RTA_OK(attr, length); attr = RTA_NEXT(attr, length)) {
+            if(attr->rta_type != IFA_ADDRESS)
+              continue;
+            char address[INET6_ADDRSTRLEN];
+            if(inet_ntop(info->ifa_family, RTA_DATA(attr), address, sizeof(address)) == nullptr)
+              continue;
+            auto interface = m_interfaces.find(info->ifa_index);
+            if(interface == m_interfaces.end())
+              continue;
+            if(header->nlmsg_type == RTM_NEWADDR)
+              interface->second.addresses.insert(address);
+            else
+              interface->second.addresses.erase(address);
+            changed = true;
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  if(size < 0 && errno == ENOBUFS) {
+    // Notifications have been lost. State is read again.
+    debug << "Netlink buffer overrun" << std::endl;
+    m_interfaces.clear();
+    request_dump(RTM_GETLINK);
+  }
+
+  if(changed)
+    update_state();
+}
+
+void Network::update_state()
+{
+  std::string icon = m_icon_offline;
+  for(auto & item : m_interfaces) {
+    Interface & interface = item.second;
+    if(interface.loopback || !interface.up || interface.addresses.empty())
+      continue;
+    if(interface.wireless) {
+      icon = m_icon_wireless;
+      break;
+    }
+    icon = m_icon_wired;
+  }
+  if(icon != m_icon) {
+    debug << "Network icon " << icon << std::endl;
+    m_icon = icon;
+    set_icon(icon);
+    if(send_repaint)
+      send_repaint();
+  }
+  if(m_tooltip_visible)
+    show_statistics();
+}
+
+void Network::show_statistics()
+{
+  long now = Stats::now_usecs() / 1000;
+  long elapsed = now - m_last_sample;
+  std::string text;
+
+  for(auto & item : m_interfaces) {
+    Interface & interface = item.second;
+    if(interface.loopback)
+      continue;
+    if(!text.empty())
+      text += "\n";
+    text += interface.name + (interface.up ? ": connected" : ": disconnected");
+    for(const std::string & address : interface.addresses)
+      text += "\n  " + address;
+    if(!interface.up)
+      continue;
+    std::string path = "/sys/class/net/" + interface.name + "/statistics/";
+    uint64_t rx_bytes = read_counter(path + "rx_bytes");
+    uint64_t tx_bytes = read_counter(path + "tx_bytes");
+    if(m_last_sample > 0 && elapsed > 0 && rx_bytes >= interface.rx_bytes && tx_bytes >= interface.tx_bytes) {
+      text += "\n  Down: " + format_rate((rx_bytes - interface.rx_bytes) * 1000 / elapsed);
+      text += "  Up: " + format_rate((tx_bytes - interface.tx_bytes) * 1000 / elapsed);
+    }
+    interface.rx_bytes = rx_bytes;
+    interface.tx_bytes = tx_bytes;
+  }
+  m_last_sample = now;
+
+  if(text.empty())
+    text = "No network interfaces";
+  show_tooltip(text);
+}
+
+void Network::mouse_enter()
+{
+  // Byte counters are only sampled while tooltip is shown
+  m_tooltip_visible = true;
+  m_last_sample = 0;
+  show_statistics();
+  set_timeout(1000);
+}
+
+void Network::mouse_leave()
+{
+  m_tooltip_visible = false;
+  set_timeout(-1);
+}
+
+void Network::timeout()
+{
+  if(m_tooltip_visible)
+    show_statistics();
+}
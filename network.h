@@ -0,0 +1,81 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __NETWORK_H__
+#define __NETWORK_H__
+
+#include <string>
+#include <functional>
+#include <map>
+#include <set>
+#include <stdint.h>
+#include "buttonruncommand.h"
+
+
+/*! \class Network
+ *  \brief Network status item to add to panel.
+ *
+ *  Network state is read from rtnetlink notifications (links and addresses)
+ *  in the main loop. There isn't any polling: the icon is only changed
+ *  when the kernel sends a notification. Byte counters of interfaces are
+ *  only read while the tooltip is shown.
+ *
+ *  As ButtonRunCommand child a command can be run when
+ *  item is clicked.
+ */
+class Network : public ButtonRunCommand
+{
+public:
+  Network(
+     const std::string & icon_wireless, // Connected by a wireless interface
+     const std::string & icon_wired,    // Connected by a wired interface
+     const std::string & icon_offline   // Not connected
+  );
+  virtual ~Network();
+
+  virtual void timeout() override;
+  virtual void mouse_enter() override;
+  virtual void mouse_leave() override;
+
+  std::function<void()> send_repaint;
+
+private:
+  struct Interface
+  {
+    std::string name;
+    bool up, loopback, wireless;
+    std::set<std::string> addresses;
+    uint64_t rx_bytes, tx_bytes;
+  };
+
+  void request_dump(int type);
+  void read_netlink();
+  void update_state();
+  void show_statistics();
+
+  std::string
+    m_icon_wireless,
+    m_icon_wired,
+    m_icon_offline;
+  std::string m_icon; // Shown icon
+  int m_fd;
+  uint32_t m_seq;
+  int m_dump; // Type of running dump request or 0
+  std::map<int, Interface> m_interfaces;
+  bool m_tooltip_visible;
+  long m_last_sample; // In milliseconds
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include <sstream>
 #include <ctime>
 #include <algorithm>
+#include <cmath>
 #include <random>
 
 #include <wayland-client.hpp>
@@ -30,10 +31,15 @@
 
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/inotify.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <poll.h>
+#include <string.h>
+#include <errno.h>
 #include <time.h>
+#include <filesystem>
 
 #include <cairo/cairo.h>
 
@@ -42,8 +48,20 @@
 #include "buttonruncommand.h"
 #include "clock.h"
 #include "battery.h"
+#include "script.h"
+#include "sysmonitor.h"
+#include "perfhud.h"
+#include "network.h"
+#include "sysfswatch.h"
+#include "eventloop.h"
 #include "panel.h"
 #include "settings.h"
+#include "style.h"
+#include "stats.h"
+#include "trace.h"
+#include "allocations.h"
+#include "framearena.h"
+#include "iconindex.h"
 
 #define WIDTH 34
 #define HEIGHT 34
@@ -54,9 +72,20 @@ using namespace wayland;
 
 void Panel::draw(uint32_t serial, bool update_items_only)
 {
-  if(!surface || !shared_mem)
+  static Latency *draw_latency = Stats::get_stats()->latency("draw");
+  static Latency *layout_latency = Stats::get_stats()->latency("layout");
+  static Latency *paint_item_latency = Stats::get_stats()->latency("paint_item");
+  static Latency *paint_toplevel_latency = Stats::get_stats()->latency("paint_toplevel");
+
+  // Headless panels create cairo_surface when they are initialized
+  if(cairo_surface == nullptr && (!surface || !shared_mem))
     return;
 
+  TRACE_SCOPE("Panel::draw");
+  ScopedLatency draw_timer(draw_latency);
+  // Partial repaints (hover, clock ticks,...) are the steady state of panel
+  ALLOCATION_AUDIT_SCOPE(update_items_only ? "Panel::draw" : nullptr);
+
   if(cairo_surface == nullptr) {
     cairo_surface = cairo_image_surface_create_for_data((unsigned char*)(shared_mem->get_mem()), CAIRO_FORMAT_ARGB32, m_width, m_height, /*stride*/ m_width*4);
 
@@ -69,43 +98,53 @@ void Panel::draw(uint32_t serial, bool update_items_only)
     }
   }
 
-  Color color = Settings::get_settings()->color();
-  Color background_color = Settings::get_settings()->background_color();
+  std::shared_ptr<const Style> style = Style::get_style();
 
   cairo_t *cr = cairo_create(cairo_surface);
-  cairo_set_source_rgba (cr, color.red, color.green, color.blue, 0);
+  cairo_set_source_rgba (cr, 0, 0, 0, 0);
   cairo_paint(cr);
 
   // Draw window frame
   if(! update_items_only) {
-    cairo_set_source_rgba (cr, background_color.red, background_color.green, background_color.blue, 1.0);
+    cairo_set_source(cr, style->background());
     cairo_rectangle (cr, 0, 0, m_width, m_height);
     cairo_fill(cr);
   }
 
   // Draw panel items
+  bool painted = !update_items_only;
   uint32_t x_start = 0, x_end = m_width;
-  for(auto item : m_panel_items) {
+  for(const std::shared_ptr<PanelItem> & item : m_panel_items) {
     uint32_t x = item->is_start_pos() ? x_start : (x_end - item->get_width());
     if(update_items_only) {
       if(item->need_repaint()) {
         uint32_t width = item->get_width(), height = item->get_height();
-        item->update_size(cr);
+        {
+          ScopedLatency timer(layout_latency);
+          item->update_size(cr);
+        }
         if(width != item->get_width() || height != item->get_height()) {
           // Total repaint is needed
           debug << "Total repaint is needed" << std::endl;
+          ALLOCATION_AUDIT_CANCEL();
           cairo_destroy(cr);
           draw(serial, false);
           return;
         }
         item->set_pos(x, 0);
+        ScopedLatency timer(paint_item_latency);
         item->repaint(cr);
-        surface.damage(item->get_x(), item->get_y(), item->get_width(), item->get_height());
+        damage(item->get_x(), item->get_y(), item->get_width(), item->get_height());
+        painted = true;
       }
     } else {
-      item->update_size(cr);
+      {
+        ScopedLatency timer(layout_latency);
+        item->update_size(cr);
+      }
       x = item->is_start_pos() ? x_start : (x_end - item->get_width());
       item->set_pos(x, 0);
+      ScopedLatency timer(paint_item_latency);
       item->repaint(cr);
     }
     if(item->is_start_pos())
@@ -118,63 +157,325 @@ void Panel::draw(uint32_t serial, bool update_items_only)
   cairo_save(cr);
   cairo_rectangle(cr, x_start, 0, x_end - x_start, m_height);
   cairo_clip(cr);
-  uint32_t x_toplevels = 0, n_toplevels = 0;
-  for(std::shared_ptr<ToplevelButton> item : m_toplevel_handles) {
-    x_toplevels += item->get_width();
-    n_toplevels++;
-  }
-  // Change toplevel items offset if there is not enoght space 
-  // and user moves the mouse wheel
-  if(x_toplevels > (x_end - x_start))
-    x_toplevels += m_toplevel_items_offset;
-  x_toplevels = (x_start + x_end - x_toplevels) / 2;
+  int toplevels_width = 0;
+  for_each_toplevel_item([&](Button *item) {
+    toplevels_width += item->get_width();
+  });
+  // If there is not enoght space, toplevel items are drawn from x_start
+  // and user can move them with the mouse wheel
+  int x_toplevels;
+  int max_offset = std::max(0, toplevels_width - (int)(x_end - x_start));
+  m_toplevel_items_offset = std::clamp(m_toplevel_items_offset, 0, max_offset);
+  m_toplevel_scroll_target = std::clamp(m_toplevel_scroll_target, 0, max_offset);
+  if(max_offset > 0)
+    x_toplevels = (int)x_start - m_toplevel_items_offset;
+  else
+    x_toplevels = ((int)(x_start + x_end) - toplevels_width) / 2;
+  m_toplevels_x_start = x_start;
+  m_toplevels_x_end = x_end;
 
-  for(std::shared_ptr<ToplevelButton> item : m_toplevel_handles) {
+  // Only items on screen are painted
+  for_each_toplevel_item([&](Button *item) {
     item->set_pos(x_toplevels, 0);
-    if(update_items_only) {
+    if(x_toplevels + item->get_width() <= m_toplevels_x_start || x_toplevels >= m_toplevels_x_end) {
+      // Items moved off screen lose the pointer and their tooltip
+      item->on_mouse_leave(m_last_cursor_x, m_last_cursor_y, true);
+      item->drop_caches();
+    } else if(update_items_only) {
       if(item->need_repaint()) {
+        ScopedLatency timer(paint_toplevel_latency);
         item->repaint(cr);
-        surface.damage(item->get_x(), item->get_y(), item->get_width(), item->get_height());
+        damage(item->get_x(), item->get_y(), item->get_width(), item->get_height());
+        painted = true;
       }
     } else {
+      ScopedLatency timer(paint_toplevel_latency);
       item->repaint(cr);
     }
     x_toplevels += item->get_width(); 
-  }
+  });
   cairo_restore(cr);
 
 
   cairo_destroy(cr);
+  ALLOCATION_AUDIT_END();
+
+  // Pointer has moved, but no item has changed
+  if(!painted)
+    return;
 
-  surface.attach(buffer.at(0), 0, 0);
   if(! update_items_only)
-    surface.damage(0, 0, m_width, m_height);
+    damage(0, 0, m_width, m_height);
 
-  surface.commit();
+  commit_frame();
   debug << "draw finished\n";
 }
 
-Panel::Panel()
+/** Draws a frame of the scroll animation of toplevel items.
+ *  Pixels of the toplevels area are moved and only new columns are painted.
+ *  Next frame is drawn when the compositor asks for it.
+ */
+void Panel::scroll_toplevels()
+{
+  if(cairo_surface == nullptr)
+    return;
+  TRACE_SCOPE("Panel::scroll_toplevels");
+
+  int toplevels_width = 0;
+  for_each_toplevel_item([&](Button *item) {
+    toplevels_width += item->get_width();
+  });
+  int width = m_toplevels_x_end - m_toplevels_x_start;
+  int max_offset = std::max(0, toplevels_width - width);
+  m_toplevel_scroll_target = std::clamp(m_toplevel_scroll_target, 0, max_offset);
+  int distance = m_toplevel_scroll_target - m_toplevel_items_offset;
+  if(distance == 0 || width <= 0) {
+    m_scrolling = false;
+    return;
+  }
+  // Animation slows down at the end
+  int dx = distance / 3;
+  if(dx == 0)
+    dx = distance > 0 ? 1 : -1;
+  m_toplevel_items_offset += dx;
+
+  // Move pixels of toplevels area
+  int x_start = m_toplevels_x_start, x_end = m_toplevels_x_end;
+  if(std::abs(dx) < width) {
+    cairo_surface_flush(cairo_surface);
+    unsigned char *data = cairo_image_surface_get_data(cairo_surface);
+    int stride = cairo_image_surface_get_stride(cairo_surface);
+    for(uint32_t y = 0; y < m_height; y++) {
+      uint32_t *row = (uint32_t*)(data + y * stride);
+      if(dx > 0)
+        memmove(row + x_start, row + x_start + dx, (width - dx) * 4);
+      else
+        memmove(row + x_start - dx, row + x_start, (width + dx) * 4);
+    }
+    cairo_surface_mark_dirty(cairo_surface);
+    // Columns which must be painted
+    if(dx > 0)
+      x_start = x_end - dx;
+    else
+      x_end = x_start - dx;
+  }
+
+  cairo_t *cr = cairo_create(cairo_surface);
+  cairo_rectangle(cr, x_start, 0, x_end - x_start, m_height);
+  cairo_clip(cr);
+  cairo_set_source(cr, Style::get_style()->background());
+  cairo_paint(cr);
+  int x = m_toplevels_x_start - m_toplevel_items_offset;
+  for_each_toplevel_item([&](Button *item) {
+    item->set_pos(x, 0);
+    if(x + item->get_width() <= m_toplevels_x_start || x >= m_toplevels_x_end) {
+      item->on_mouse_leave(m_last_cursor_x, m_last_cursor_y, true);
+      item->drop_caches();
+    } else if(x + item->get_width() > x_start && x < x_end) {
+      item->repaint(cr);
+    }
+    x += item->get_width();
+  });
+  cairo_destroy(cr);
+
+  damage(m_toplevels_x_start, 0, width, m_height);
+  if(m_toplevel_items_offset != m_toplevel_scroll_target) {
+    // Headless panels draw next frame without waiting
+    if(!surface) {
+      commit_frame();
+      return;
+    }
+    frame_cb = surface.frame();
+    frame_cb.on_done() = [&](uint32_t time) {
+      m_repaint_scroll = true;
+    };
+  } else
+    m_scrolling = false;
+  commit_frame();
+}
+
+/** Draws the parts of panel which have been changed.
+ */
+void Panel::paint_pending()
+{
+  if(m_repaint_full)
+    draw();
+  if(m_repaint_scroll)
+    scroll_toplevels();
+  if(!m_repaint_full && m_repaint_partial)
+    draw(-1, true);
+}
+
+void Panel::damage(int x, int y, int width, int height)
+{
+  if(surface)
+    surface.damage(x, y, width, height);
+}
+
+/** Sets the event which has caused the next frame. 
+ *  If there are several events, the first one is used.
+ */
+void Panel::set_frame_cause(FrameCause cause)
+{
+  if(m_frame_cause == FrameCause::NONE) {
+    m_frame_cause = cause;
+    m_frame_cause_usecs = Stats::now_usecs();
+  }
+}
+
+/** Sets a pointer event as cause of the next frame. event_msecs is the
+ *  time of the event, so time waiting in the socket is measured too. 
+ *  Its base is undefined, compositors use CLOCK_MONOTONIC. If it is not
+ *  in the last second, time of the handler is used.
+ */
+void Panel::set_frame_cause(FrameCause cause, uint32_t event_msecs)
+{
+  if(m_frame_cause != FrameCause::NONE)
+    return;
+  uint64_t now = Stats::now_usecs();
+  // Milliseconds wrap around every 49 days
+  uint32_t delay_msecs = (uint32_t)(now / 1000) - event_msecs;
+  m_frame_cause = cause;
+  m_frame_cause_usecs = delay_msecs < 1000 ? now - (uint64_t)delay_msecs * 1000 : now;
+}
+
+/** Converts a time from the presentation clock to Stats::now_usecs() clock.
+ */
+static uint64_t presentation_time_usecs(clockid_t clock, uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec)
+{
+  int64_t time = (int64_t)(((uint64_t)tv_sec_hi << 32) | tv_sec_lo) * 1000000 + tv_nsec / 1000;
+  if(clock == CLOCK_MONOTONIC)
+    return time;
+  struct timespec now;
+  clock_gettime(clock, &now);
+  int64_t now_usecs = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+  return Stats::now_usecs() - (now_usecs - time);
+}
+
+/** Commits the panel surface. Time since the event that has caused the frame
+ *  is recorded and, if the compositor supports wp_presentation, the time 
+ *  until the frame is shown.
+ */
+void Panel::commit_frame()
+{
+  static Latency *commit_latency = Stats::get_stats()->latency("commit");
+  static Latency *cause_latencies[] = {
+    nullptr,
+    Stats::get_stats()->latency("pointer_to_commit"),
+    Stats::get_stats()->latency("timer_to_commit"),
+    Stats::get_stats()->latency("event_to_commit"),
+    Stats::get_stats()->latency("toplevel_to_commit")
+  };
+  static uint64_t *frames = Stats::get_stats()->counter("frames");
+
+  (*frames)++;
+  uint64_t commit_usecs = Stats::now_usecs();
+  if(m_frame_cause != FrameCause::NONE) {
+    cause_latencies[(int)m_frame_cause]->record(commit_usecs - m_frame_cause_usecs);
+    m_frame_cause = FrameCause::NONE;
+  }
+  if(!surface) {
+    // Headless panels act as a compositor which shows the last frame
+    // committed before each vblank: a frame which is waiting is replaced.
+    if(!m_presentation_feedbacks.empty())
+      frame_discarded(m_presentation_feedbacks.back());
+    m_presentation_feedbacks.clear();
+    m_presentation_feedbacks.push_back({presentation_feedback_t(), commit_usecs, false});
+    return;
+  }
+
+  if(presentation) {
+    m_presentation_feedbacks.push_back({presentation.feedback(surface), commit_usecs, false});
+    PresentationFeedback *feedback = &m_presentation_feedbacks.back();
+    // Feedbacks are removed in the events loop, not from their own events
+    feedback->feedback.on_presented() = [this, feedback](uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh, uint32_t seq_hi, uint32_t seq_lo, presentation_feedback_kind flags) {
+      frame_presented(*feedback, presentation_time_usecs(m_presentation_clock, tv_sec_hi, tv_sec_lo, tv_nsec));
+    };
+    feedback->feedback.on_discarded() = [this, feedback]() {
+      frame_discarded(*feedback);
+    };
+  }
+
+  TRACE_SCOPE("wl_surface_commit");
+  ScopedLatency timer(commit_latency);
+  surface.attach(buffer.at(0), 0, 0);
+  surface.commit();
+}
+
+void Panel::frame_presented(PresentationFeedback & feedback, uint64_t present_usecs)
+{
+  static Latency *present_latency = Stats::get_stats()->latency("commit_to_present");
+  if(present_usecs > feedback.commit_usecs)
+    present_latency->record(present_usecs - feedback.commit_usecs);
+  else
+    present_latency->record(0);
+  feedback.done = true;
+}
+
+void Panel::frame_discarded(PresentationFeedback & feedback)
+{
+  static uint64_t *discarded = Stats::get_stats()->counter("frames_discarded");
+  (*discarded)++;
+  feedback.done = true;
+}
+
+/** Vblank of headless panels: the frame which is waiting is presented.
+ */
+void Panel::present_headless_frame()
+{
+  if(surface || m_presentation_feedbacks.empty())
+    return;
+  frame_presented(m_presentation_feedbacks.back(), Stats::now_usecs());
+  m_presentation_feedbacks.clear();
+}
+
+/** Connects to Wayland compositor. Headless panels get a display connected 
+ *  to a socket nobody reads, so they can give its fd to items.
+ */
+static display_t connect_display(bool headless)
+{
+  if(!headless)
+    return display_t();
+  int fds[2];
+  if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+    throw std::runtime_error(debug_get_func + "socketpair failed.");
+  return display_t(fds[0]);
+}
+
+Panel::Panel(bool headless) : display(connect_display(headless))
 {
   m_width = Settings::get_settings()->panel_size();
   m_height = Settings::get_settings()->panel_size();
   m_last_cursor_x = m_last_cursor_y = 0;
+  m_hovered_toplevel = nullptr;
   m_toplevel_items_offset = 0;
+  m_toplevels_x_start = m_toplevels_x_end = 0;
+  m_toplevel_scroll_target = 0;
+  m_axis_discrete = 0;
+  m_frame_cause = FrameCause::NONE;
+  m_frame_cause_usecs = 0;
+  m_presentation_clock = CLOCK_MONOTONIC;
+  m_repaint_scroll = m_scrolling = false;
+  m_group_toplevels = false;
   cairo_surface = nullptr;
   m_repaint_full = true;
   m_repaint_partial = false;
   tooltip_cairo_surface = nullptr;
   tooltip_shared_mem = nullptr;
+  m_settings_fd = -1;
 }
 
 void Panel::init()
 {
   m_width = m_height = Settings::get_settings()->panel_size();
+  m_group_toplevels = Settings::get_settings()->group_toplevels();
   // retrieve global objects
   registry = display.get_registry();
   registry.on_global() = [&] (uint32_t name, const std::string& interface, uint32_t version)
   {
     debug << "Found interface " << interface << " version " << version << std::endl;
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("global", name, interface, version);
 
     if(interface == compositor_t::interface_name) {
       registry.bind(name, compositor, version);
@@ -202,18 +503,38 @@ void Panel::init()
         debug << "  toplevel_manager::on_toplevel" << std::endl;
         on_toplevel_listener(handle);
       };
+    } else if(interface == presentation_t::interface_name) {
+      debug << "Binding interface " << presentation_t::interface_name << std::endl;
+      registry.bind(name, presentation, version);
+      presentation.on_clock_id() = [&](uint32_t clock_id) {
+        m_presentation_clock = clock_id;
+      };
     } else if(interface == output_t::interface_name) {
       debug << "Binding interface " << output_t::interface_name << std::endl;
       registry.bind(name, output, version);
       debug << "Binding interface finished." << std::endl;
       output.on_mode() = [&](uint32_t flags, int32_t width, int32_t height, int32_t refresh) {
+        if(EventRecorder::recording())
+          EventRecorder::get_recorder()->record("output_mode", width, height);
         m_width = width;
       };
     }
 
   };
+  registry.on_global_remove() = [&] (uint32_t name) {
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("global_remove", name);
+  };
+  static Latency *roundtrip_latency = Stats::get_stats()->latency("roundtrip");
+  uint64_t roundtrip_start;
+
   debug << "First roundtrip has been started" << std::endl;
-  display.roundtrip();
+  roundtrip_start = Stats::now_usecs();
+  {
+    TRACE_SCOPE("wl_display_roundtrip");
+    display.roundtrip();
+  }
+  roundtrip_latency->record(Stats::now_usecs() - roundtrip_start);
   debug << "First roundtrip has been finished" << std::endl;
 
   // Check if all interfaces has been loaded
@@ -237,7 +558,12 @@ void Panel::init()
   };
 
   // Load outputs sizes
-  display.roundtrip();
+  roundtrip_start = Stats::now_usecs();
+  {
+    TRACE_SCOPE("wl_display_roundtrip");
+    display.roundtrip();
+  }
+  roundtrip_latency->record(Stats::now_usecs() - roundtrip_start);
 
   // create a surface
   surface = compositor.create_surface();
@@ -245,23 +571,19 @@ void Panel::init()
   // create a shell surface
   if(layer_shell) {
     layer_shell_surface = layer_shell.get_layer_surface(surface, output, zwlr_layer_shell_v1_layer::top, std::string("Window"));
-    switch(Settings::get_settings()->panel_position()) {
-      case PanelPosition::TOP:
-        layer_shell_surface.set_anchor(zwlr_layer_surface_v1_anchor::top | zwlr_layer_surface_v1_anchor::right | zwlr_layer_surface_v1_anchor::left);
-        break;
-      default:
-        layer_shell_surface.set_anchor(zwlr_layer_surface_v1_anchor::bottom | zwlr_layer_surface_v1_anchor::right | zwlr_layer_surface_v1_anchor::left);
-    }
-    layer_shell_surface.set_size(m_width, m_height);
-    layer_shell_surface.set_exclusive_zone(Settings::get_settings()->exclusive_zone());
+    configure_layer_surface();
     layer_shell_surface.set_keyboard_interactivity(zwlr_layer_surface_v1_keyboard_interactivity::none);
     layer_shell_surface.on_configure() = [&](uint32_t serial, uint32_t width, uint32_t height) {
+      if(EventRecorder::recording())
+        EventRecorder::get_recorder()->record("configure", width, height);
       if(m_width != width || m_height != height) {
         m_width = width;
         m_height = height; 
         debug << "[layer_shell_surface.on_configure()] " << width << " x " << height << std::endl;
         layer_shell_surface.set_size(m_width, m_height);
         layer_shell_surface.set_exclusive_zone(Settings::get_settings()->exclusive_zone());
+        if(shared_mem)
+          resize_buffers();
         surface.damage(0, 0, m_width, m_height);
         surface.commit();
       }
@@ -283,7 +605,12 @@ void Panel::init()
   surface.commit();
 
   debug << "Second roundtrip has been started" << std::endl;
-  display.roundtrip();
+  roundtrip_start = Stats::now_usecs();
+  {
+    TRACE_SCOPE("wl_display_roundtrip");
+    display.roundtrip();
+  }
+  roundtrip_latency->record(Stats::now_usecs() - roundtrip_start);
   debug << "Second roundtrip has been finished" << std::endl;
 
   // Get input devices
@@ -296,11 +623,7 @@ void Panel::init()
   keyboard = seat.get_keyboard();
 
   // create shared memory
-  shared_mem = std::make_shared<shared_mem_t>(2*m_width*m_height*4);
-  auto pool = shm.create_pool(shared_mem->get_fd(), 2*m_width*m_height*4);
-  for(unsigned int c = 0; c < 2; c++)
-    buffer.at(c) = pool.create_buffer(c*m_width*m_height*4, m_width, m_height, m_width*4, shm_format::argb8888);
-  cur_buf = 0;
+  resize_buffers();
 
   // load cursor theme
   debug << "Cursor theme " << Settings::get_settings()->cursor_theme() << std::endl;
@@ -325,79 +648,46 @@ void Panel::init()
     cursor_surface.commit();
     pointer.set_cursor(serial, cursor_surface, 0, 0);
     debug << "Cursor " << x << y << std::endl;
-    m_last_cursor_x = x;
-    m_last_cursor_y = y;
-    for(auto item : m_panel_items)
-      item->on_mouse_enter(x, y);
-    for(std::shared_ptr<ToplevelButton> item : m_toplevel_handles)
-      item->on_mouse_enter(x, y);
-
-    m_repaint_partial = true;
-    //draw(serial, true);
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("enter", x, y);
+    pointer_enter(x, y);
   };
 
   pointer.on_leave() = [&] (uint32_t serial, const surface_t& /*unused*/)
   {
-    debug << "on_leave\n";
-    for(auto item : m_panel_items)
-      item->on_mouse_leave(m_last_cursor_x, m_last_cursor_y, true);
-    for(std::shared_ptr<ToplevelButton> item : m_toplevel_handles)
-      item->on_mouse_leave(m_last_cursor_x, m_last_cursor_y, true);
-    m_repaint_partial = true;
-    ToolTip::hide();
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("leave");
+    pointer_leave();
   };
 
   pointer.on_motion() = [&] (uint32_t time, double x, double y)
   {
-    //printf("Cursor %f,%f\n", x, y);
-    m_last_cursor_x = x;
-    m_last_cursor_y = y;
-    for(auto item : m_panel_items) {
-      item->on_mouse_enter(x, y);
-      item->on_mouse_leave(x, y, false);
-    }
-    for(std::shared_ptr<ToplevelButton> item : m_toplevel_handles) {
-      item->on_mouse_enter(x, y);
-      item->on_mouse_leave(x, y, false);
-    }
-    m_repaint_partial = true;
-    //draw(-1, true);
+    set_frame_cause(FrameCause::POINTER, time);
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("motion", x, y);
+    pointer_motion(x, y);
   };
 
-  pointer.on_button() = [&] (uint32_t serial, uint32_t /*unused*/, uint32_t button, pointer_button_state state)
+  pointer.on_button() = [&] (uint32_t serial, uint32_t time, uint32_t button, pointer_button_state state)
   {
-    debug << "Button action  " << button << std::endl;
-    if(/*(button == BTN_LEFT || button == BTN_RIGHT) && */state == pointer_button_state::pressed) {
-      debug << "Button pressed\n";
-      //showToolTip();
-
-      for(auto item : m_panel_items)
-        item->on_mouse_clicked(m_last_cursor_x, m_last_cursor_y, button);
-      for(std::shared_ptr<ToplevelButton> item : m_toplevel_handles)
-        //((PanelItem*)item)->on_mouse_clicked(m_last_cursor_x, m_last_cursor_y, button);
-        item->on_mouse_clicked(m_last_cursor_x, m_last_cursor_y, button);
-      m_repaint_partial = true;
-      //draw(serial, true);
-    } else if(/*(button == BTN_LEFT || button == BTN_RIGHT) && */state != pointer_button_state::pressed) {
-      for(auto item : m_panel_items)
-        item->on_mouse_released(m_last_cursor_x, m_last_cursor_y);
-      for(std::shared_ptr<ToplevelButton> item : m_toplevel_handles)
-        item->on_mouse_released(m_last_cursor_x, m_last_cursor_y);
-      m_repaint_partial = true;
-      //draw(serial, true);
-    }
+    set_frame_cause(FrameCause::POINTER, time);
+    bool pressed = state == pointer_button_state::pressed;
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("button", button, (int)pressed);
+    pointer_button(button, pressed);
+  };
+
+  pointer.on_axis_discrete() = [&] (pointer_axis axis, int32_t discrete) {
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("axis_discrete", discrete);
+    pointer_scroll_discrete(discrete);
   };
 
   pointer.on_axis() = [&] (uint32_t time, pointer_axis axis, double value) {
-    // Change toplevel items offset if there is not enoght space 
-    // and user moves the mouse wheel
-    //if(axis == pointer_axis::vertical_scroll)
-    //  printf("on_axis: axis vertical\n");
-    //else
-    //  printf("on_axis: axis horizontal\n");
-    m_toplevel_items_offset += (value > 0.0 ? 1 : -1) * Settings::get_settings()->panel_size();
-    m_repaint_full = true;
-    //draw();
+    set_frame_cause(FrameCause::POINTER, time);
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("axis", value);
+    pointer_scroll(value);
   };
 
   // press 'q' to exit
@@ -414,37 +704,390 @@ void Panel::init()
   debug << "Drawn" << std::endl;
 
   tooltip.init(&compositor, &display, &xdg_wm_base, &shm, &layer_shell_surface, &m_width, &m_height);
+
+  watch_settings();
+}
+
+void Panel::configure_layer_surface()
+{
+  switch(Settings::get_settings()->panel_position()) {
+    case PanelPosition::TOP:
+      layer_shell_surface.set_anchor(zwlr_layer_surface_v1_anchor::top | zwlr_layer_surface_v1_anchor::right | zwlr_layer_surface_v1_anchor::left);
+      break;
+    default:
+      layer_shell_surface.set_anchor(zwlr_layer_surface_v1_anchor::bottom | zwlr_layer_surface_v1_anchor::right | zwlr_layer_surface_v1_anchor::left);
+  }
+  layer_shell_surface.set_size(m_width, Settings::get_settings()->panel_size());
+  layer_shell_surface.set_exclusive_zone(Settings::get_settings()->exclusive_zone());
+}
+
+/** Buffers are created again when panel size changes.
+ */
+void Panel::resize_buffers()
+{
+  if(cairo_surface != nullptr) {
+    cairo_surface_destroy(cairo_surface);
+    cairo_surface = nullptr;
+  }
+  shared_mem = std::make_shared<shared_mem_t>(2*m_width*m_height*4);
+  auto pool = shm.create_pool(shared_mem->get_fd(), 2*m_width*m_height*4);
+  for(unsigned int c = 0; c < 2; c++)
+    buffer.at(c) = pool.create_buffer(c*m_width*m_height*4, m_width, m_height, m_width*4, shm_format::argb8888);
+  cur_buf = 0;
+  m_repaint_full = true;
 }
 
+/** Settings directory is watched instead of the file, because editors
+ *  usually save files writing a new file and renaming it.
+ */
+void Panel::watch_settings()
+{
+  std::error_code error;
+  std::filesystem::path path = std::filesystem::canonical(Settings::get_settings()->path(), error);
+  if(error)
+    return;
+  m_settings_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(m_settings_fd < 0 || inotify_add_watch(m_settings_fd, path.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    debug_error << "Settings file cannot be watched: " << strerror(errno) << std::endl;
+    if(m_settings_fd >= 0)
+      close(m_settings_fd);
+    m_settings_fd = -1;
+    return;
+  }
+  std::string name = path.filename();
+  EventLoop::add_fd(m_settings_fd, POLLIN, [this, name](short revents) {
+    alignas(struct inotify_event) char buffer[4096];
+    bool changed = false;
+    ssize_t size;
+    while((size = read(m_settings_fd, buffer, sizeof(buffer))) > 0) {
+      for(char *ptr = buffer; ptr < buffer + size; ) {
+        const struct inotify_event *event = (const struct inotify_event *)ptr;
+        if(event->len > 0 && name == event->name)
+          changed = true;
+        ptr += sizeof(struct inotify_event) + event->len;
+      }
+    }
+    if(changed)
+      reload_settings();
+  });
+}
 
-void Panel::on_toplevel_listener(zwlr_foreign_toplevel_handle_v1_t toplevel_handle)
+/** Loads settings again. Items whose settings haven't changed are kept 
+ *  with their icons and caches, the others are built again.
+ *  If the new file cannot be parsed or it has wrong values, panel isn't 
+ *  changed.
+ */
+void Panel::reload_settings()
+{
+  static uint64_t *reloads = Stats::get_stats()->counter("settings_reloads");
+  TRACE_SCOPE("Panel::reload_settings");
+  Settings *settings = Settings::get_settings();
+  int panel_size = settings->panel_size();
+  PanelPosition panel_position = settings->panel_position();
+  int exclusive_zone = settings->exclusive_zone();
+  // Wrong items are found when settings have been changed
+  Settings previous_settings = *settings;
+  std::shared_ptr<const Style> previous_style = Style::get_style();
+
+  std::vector<std::shared_ptr<PanelItem> > items;
+  items.swap(m_panel_items);
+  for(const std::shared_ptr<PanelItem> & item : items)
+    m_previous_items.emplace(item->get_config(), item);
+  try {
+    settings->load_settings(settings->path(), this);
+  } catch(const std::exception & e) {
+    debug_error << "Settings cannot be loaded: " << e.what() << std::endl;
+    // Icons have been indexed for the wrong settings
+    bool rebuild_index = settings->icon_theme() != previous_settings.icon_theme() || settings->panel_size() != previous_settings.panel_size();
+    *settings = previous_settings;
+    Style::set_style(previous_style);
+    m_panel_items.swap(items);
+    m_previous_items.clear();
+    if(rebuild_index)
+      rebuild_icon_index();
+    return;
+  }
+  size_t kept = items.size() - m_previous_items.size();
+  debug << "Settings reloaded: " << kept << " items kept, " << m_panel_items.size() - kept << " items built" << std::endl;
+  // Removed items are destroyed here
+  m_previous_items.clear();
+  items.clear();
+  (*reloads)++;
+
+  ToolTip::hide();
+  set_group_toplevels(settings->group_toplevels());
+  if(settings->panel_size() != panel_size) {
+    // Icons of toplevels are scaled when they are painted
+    for(const std::shared_ptr<ToplevelGroup> & item : m_toplevel_groups_order) {
+      item->set_width(settings->panel_size());
+      item->set_height(settings->panel_size());
+    }
+    m_toplevel_handles.buttons.for_each([&](const std::shared_ptr<ToplevelButton> & item) {
+      item->set_width(settings->panel_size());
+      item->set_height(settings->panel_size());
+    });
+  }
+  if(settings->panel_size() != panel_size || settings->panel_position() != panel_position || settings->exclusive_zone() != exclusive_zone) {
+    if(!surface)
+      resize_headless(m_width, settings->panel_size());
+    else if(layer_shell_surface) {
+      // Compositor answers with a configure event, which resizes buffers
+      configure_layer_surface();
+      surface.commit();
+    }
+  }
+  set_frame_cause(FrameCause::EVENT);
+  m_repaint_full = true;
+}
+
+void Panel::rebuild_icon_index()
+{
+  IconIndex *index = IconIndex::get_index();
+  index->reset();
+  Icon::clear_cache();
+  ToplevelButton::clear_app_id_icons();
+  m_toplevel_handles.pool.clear();
+  Icon::add_index_tasks(index);
+  ToplevelButton::add_index_tasks(index);
+  index->start();
+}
+
+void Panel::update_toplevel_icons()
+{
+  // Icons of closed windows can also be wrong
+  m_toplevel_handles.pool.clear();
+  m_toplevel_handles.buttons.for_each([&](const std::shared_ptr<ToplevelButton> & item) {
+    item->update_icon();
+  });
+  for(const std::shared_ptr<ToplevelGroup> & group : m_toplevel_groups_order)
+    group->update();
+  set_frame_cause(FrameCause::EVENT);
+  m_repaint_full = true;
+}
+
+/** Toplevels are grouped by application or shown one by one.
+ */
+void Panel::set_group_toplevels(bool group)
+{
+  if(group == m_group_toplevels)
+    return;
+  m_group_toplevels = group;
+  m_hovered_toplevel = nullptr;
+  m_toplevel_groups.clear();
+  m_toplevel_groups_order.clear();
+  if(m_group_toplevels) {
+    m_toplevel_handles.buttons.for_each([&](const std::shared_ptr<ToplevelButton> & item) {
+      add_to_toplevel_group(item.get());
+    });
+  }
+  m_toplevel_items_offset = m_toplevel_scroll_target = 0;
+  m_repaint_full = true;
+}
+
+
+void Panel::pointer_enter(double x, double y)
+{
+  m_last_cursor_x = x;
+  m_last_cursor_y = y;
+  set_frame_cause(FrameCause::POINTER);
+  for(const std::shared_ptr<PanelItem> & item : m_panel_items)
+    item->on_mouse_enter(x, y);
+  for_each_visible_toplevel_item([&](Button *item) {
+    item->on_mouse_enter(x, y);
+    if(item->is_in(x, y))
+      m_hovered_toplevel = item;
+  });
+
+  m_repaint_partial = true;
+}
+
+void Panel::pointer_leave()
+{
+  debug << "on_leave\n";
+  set_frame_cause(FrameCause::POINTER);
+  for(const std::shared_ptr<PanelItem> & item : m_panel_items)
+    item->on_mouse_leave(m_last_cursor_x, m_last_cursor_y, true);
+  for_each_toplevel_item([&](Button *item) {
+    item->on_mouse_leave(m_last_cursor_x, m_last_cursor_y, true);
+  });
+  m_hovered_toplevel = nullptr;
+  m_repaint_partial = true;
+  ToolTip::hide();
+}
+
+void Panel::pointer_motion(double x, double y)
+{
+  m_last_cursor_x = x;
+  m_last_cursor_y = y;
+  set_frame_cause(FrameCause::POINTER);
+  for(const std::shared_ptr<PanelItem> & item : m_panel_items) {
+    item->on_mouse_enter(x, y);
+    item->on_mouse_leave(x, y, false);
+  }
+  Button *hovered = nullptr;
+  bool hovered_is_visible = false;
+  for_each_visible_toplevel_item([&](Button *item) {
+    item->on_mouse_enter(x, y);
+    item->on_mouse_leave(x, y, false);
+    if(item->is_in(x, y))
+      hovered = item;
+    hovered_is_visible = hovered_is_visible || item == m_hovered_toplevel;
+  });
+  // Previous hovered item can be out of the visible range
+  if(m_hovered_toplevel != nullptr && !hovered_is_visible)
+    m_hovered_toplevel->on_mouse_leave(x, y, true);
+  m_hovered_toplevel = hovered;
+  m_repaint_partial = true;
+}
+
+void Panel::pointer_button(uint32_t button, bool pressed)
+{
+  debug << "Button action  " << button << std::endl;
+  set_frame_cause(FrameCause::POINTER);
+  if(pressed) {
+    debug << "Button pressed\n";
+    for(const std::shared_ptr<PanelItem> & item : m_panel_items)
+      item->on_mouse_clicked(m_last_cursor_x, m_last_cursor_y, button);
+    for_each_visible_toplevel_item([&](Button *item) {
+      item->on_mouse_clicked(m_last_cursor_x, m_last_cursor_y, button);
+    });
+  } else {
+    for(const std::shared_ptr<PanelItem> & item : m_panel_items)
+      item->on_mouse_released(m_last_cursor_x, m_last_cursor_y);
+    for_each_visible_toplevel_item([&](Button *item) {
+      item->on_mouse_released(m_last_cursor_x, m_last_cursor_y);
+    });
+  }
+  m_repaint_partial = true;
+}
+
+void Panel::pointer_scroll_discrete(int32_t discrete)
+{
+  // Mouse wheels send axis_discrete before axis event
+  m_axis_discrete = discrete;
+}
+
+void Panel::pointer_scroll(double value)
+{
+  // Change toplevel items offset if there is not enoght space 
+  // and user moves the mouse wheel.
+  // Each wheel step scrolls one item. Touchpads scroll the distance moved.
+  set_frame_cause(FrameCause::POINTER);
+  if(m_axis_discrete != 0)
+    m_toplevel_scroll_target += m_axis_discrete * Settings::get_settings()->panel_size();
+  else
+    m_toplevel_scroll_target += std::lround(value);
+  m_axis_discrete = 0;
+  if(!m_scrolling) {
+    m_scrolling = true;
+    m_repaint_scroll = true;
+  }
+}
+
+ToplevelButton *Panel::on_toplevel_listener(zwlr_foreign_toplevel_handle_v1_t toplevel_handle)
 {
   auto toplevel = std::make_shared<ToplevelButton>(toplevel_handle, seat, &m_toplevel_handles);
   toplevel->set_width(Settings::get_settings()->panel_size());
   toplevel->set_height(Settings::get_settings()->panel_size());
-  toplevel->repaint_main_interface = [&](bool update_items_only) {
+  ToplevelButton *toplevel_ptr = toplevel.get();
+  toplevel->repaint_main_interface = [this, toplevel_ptr](bool update_items_only) {
+    if(m_group_toplevels) {
+      auto group = m_toplevel_groups.find(&toplevel_ptr->get_app_id());
+      if(group != m_toplevel_groups.end())
+        group->second->update();
+    }
+    set_frame_cause(FrameCause::TOPLEVEL);
     if(update_items_only)
       m_repaint_partial = true;
     else
       m_repaint_full = true;
   };
+  // Toplevels can be grouped later, if settings are reloaded
+  toplevel->app_id_changed = [this](ToplevelButton *toplevel, const std::string & old_app_id) {
+    if(!m_group_toplevels)
+      return;
+    remove_from_toplevel_group(toplevel, old_app_id);
+    add_to_toplevel_group(toplevel);
+  };
+  toplevel->closed = [this](ToplevelButton *toplevel) {
+    if(m_hovered_toplevel == toplevel)
+      m_hovered_toplevel = nullptr;
+    if(m_group_toplevels)
+      remove_from_toplevel_group(toplevel, toplevel->get_app_id());
+  };
   if(! toplevel)
     debug_error << "No free memory" << std::endl;
-  else
-    m_toplevel_handles.push_back(toplevel);
+  else {
+    toplevel->set_handle(m_toplevel_handles.buttons.insert(toplevel));
+    if(m_group_toplevels)
+      add_to_toplevel_group(toplevel.get());
+  }
+  m_repaint_full = true;
+  return toplevel_ptr;
+}
+
+void Panel::add_to_toplevel_group(ToplevelButton *toplevel)
+{
+  std::shared_ptr<ToplevelGroup> & group = m_toplevel_groups[&toplevel->get_app_id()];
+  if(group == nullptr) {
+    group = std::make_shared<ToplevelGroup>(toplevel->get_app_id());
+    group->set_width(Settings::get_settings()->panel_size());
+    group->set_height(Settings::get_settings()->panel_size());
+    m_toplevel_groups_order.push_back(group);
+  }
+  group->add(toplevel);
+  m_repaint_full = true;
+}
+
+void Panel::remove_from_toplevel_group(ToplevelButton *toplevel, const std::string & app_id)
+{
+  auto iter = m_toplevel_groups.find(&app_id);
+  if(iter == m_toplevel_groups.end())
+    return;
+  std::shared_ptr<ToplevelGroup> group = iter->second;
+  group->remove(toplevel);
+  if(group->empty()) {
+    if(m_hovered_toplevel == group.get())
+      m_hovered_toplevel = nullptr;
+    m_toplevel_groups.erase(iter);
+    m_toplevel_groups_order.erase(
+        std::remove(m_toplevel_groups_order.begin(), m_toplevel_groups_order.end(), group),
+        m_toplevel_groups_order.end()
+    );
+  }
   m_repaint_full = true;
 }
 
 
-void Panel::add_launcher(const std::string & icon, const std::string & text, const std::string & tooltip, const std::string & exec, bool start_pos)
+bool Panel::keep_item(const std::string & config)
+{
+  auto previous = m_previous_items.find(config);
+  if(previous == m_previous_items.end()) {
+    m_item_config = config;
+    return false;
+  }
+  m_panel_items.push_back(previous->second);
+  m_previous_items.erase(previous);
+  return true;
+}
+
+void Panel::add_item(std::shared_ptr<PanelItem> item)
+{
+  item->set_config(m_item_config);
+  m_item_config.clear();
+  m_panel_items.push_back(item);
+}
+
+void Panel::add_launcher(const std::string & icon, const std::string & text, const std::string & tooltip, const std::string & exec, bool persistent, bool start_pos)
 {
   auto n = std::make_shared<ButtonRunCommand>(icon, text, tooltip);
   n->set_command(exec);
+  n->set_persistent(persistent);
   n->set_fd(display.get_fd());
   n->set_width(Settings::get_settings()->panel_size() - 1);
   n->set_height(Settings::get_settings()->panel_size() - 1);
   n->set_start_pos(start_pos);
-  m_panel_items.push_back(n);
+  add_item(n);
 }
 
 void Panel::add_clock(const std::string & icon, const std::string & format, const std::string & exec, bool start_pos)
@@ -455,11 +1098,12 @@ void Panel::add_clock(const std::string & icon, const std::string & format, cons
   c->set_command(exec);
   c->send_repaint = [&]() {
     //draw(-1, true);
+    set_frame_cause(FrameCause::EVENT);
     m_repaint_partial = true;
   };
   c->set_fd(display.get_fd());
   c->set_start_pos(start_pos);
-  m_panel_items.push_back(c);
+  add_item(c);
 }
 
 void Panel::add_battery(
@@ -489,11 +1133,97 @@ void Panel::add_battery(
   c->set_command(exec);
   c->send_repaint = [&]() {
     //draw(-1, true);
+    set_frame_cause(FrameCause::EVENT);
     m_repaint_partial = true;
   };
   c->set_fd(display.get_fd());
   c->set_start_pos(start_pos);
-  m_panel_items.push_back(c);
+  add_item(c);
+}
+
+void Panel::add_script(const std::string & icon, const std::string & command, const std::string & exec, int min_interval, int restart_interval, bool start_pos)
+{
+  auto c = std::make_shared<Script>(icon, command, min_interval, restart_interval);
+  c->set_width(Settings::get_settings()->panel_size() - 1);
+  c->set_height(Settings::get_settings()->panel_size() - 1);
+  c->set_command(exec);
+  c->send_repaint = [&]() {
+    set_frame_cause(FrameCause::EVENT);
+    m_repaint_partial = true;
+  };
+  c->set_fd(display.get_fd());
+  c->set_start_pos(start_pos);
+  c->start();
+  add_item(c);
+}
+
+void Panel::add_system_monitor(int interval, int width, const std::string & exec, bool start_pos)
+{
+  auto c = std::make_shared<SysMonitor>(interval, width > 0 ? width : 2 * Settings::get_settings()->panel_size());
+  c->set_width(Settings::get_settings()->panel_size() - 1);
+  c->set_height(Settings::get_settings()->panel_size() - 1);
+  c->set_command(exec);
+  c->send_repaint = [&]() {
+    set_frame_cause(FrameCause::EVENT);
+    m_repaint_partial = true;
+  };
+  c->set_fd(display.get_fd());
+  c->set_start_pos(start_pos);
+  add_item(c);
+}
+
+void Panel::add_perf(int interval, int width, const std::string & exec, bool start_pos)
+{
+  auto c = std::make_shared<PerfHud>(interval, width > 0 ? width : 3 * Settings::get_settings()->panel_size());
+  c->set_width(Settings::get_settings()->panel_size() - 1);
+  c->set_height(Settings::get_settings()->panel_size() - 1);
+  c->set_command(exec);
+  c->send_repaint = [&]() {
+    set_frame_cause(FrameCause::EVENT);
+    m_repaint_partial = true;
+  };
+  c->set_fd(display.get_fd());
+  c->set_start_pos(start_pos);
+  add_item(c);
+}
+
+void Panel::add_network(const std::string & icon_wireless, const std::string & icon_wired, const std::string & icon_offline, const std::string & exec, bool start_pos)
+{
+  auto c = std::make_shared<Network>(icon_wireless, icon_wired, icon_offline);
+  c->set_width(Settings::get_settings()->panel_size() - 1);
+  c->set_height(Settings::get_settings()->panel_size() - 1);
+  c->set_command(exec);
+  c->send_repaint = [&]() {
+    set_frame_cause(FrameCause::EVENT);
+    m_repaint_partial = true;
+  };
+  c->set_fd(display.get_fd());
+  c->set_start_pos(start_pos);
+  add_item(c);
+}
+
+void Panel::add_sysfs(
+   const std::string & path,
+   const std::string & max_path,
+   double scale,
+   int decimals,
+   int interval,
+   const std::string & text,
+   const std::string & tooltip,
+   const std::vector<SysfsThreshold> & thresholds,
+   const std::string & exec, bool start_pos)
+{
+  auto c = std::make_shared<SysfsWatch>(path, max_path, scale, decimals, interval, text, tooltip, thresholds);
+  c->set_width(Settings::get_settings()->panel_size() - 1);
+  c->set_height(Settings::get_settings()->panel_size() - 1);
+  c->set_command(exec);
+  c->send_repaint = [&]() {
+    set_frame_cause(FrameCause::EVENT);
+    m_repaint_partial = true;
+  };
+  c->set_fd(display.get_fd());
+  c->set_start_pos(start_pos);
+  add_item(c);
 }
 
 static long get_time_milliseconds()
@@ -509,23 +1239,27 @@ void Panel::run()
   // This loop stops when runnig is false
   // Sends time out each second
   running = true;
-  struct pollfd fds[1];
+  std::vector<struct pollfd> fds;
   int timeout_msecs = -1;
   int ret;
   long now_in_msecs;
-
-  fds[0].fd = display.get_fd();
-  fds[0].events = POLLIN;
-  fds[0].revents = 0;
+  static uint64_t *wakeups = Stats::get_stats()->counter("wakeups");
+  static uint64_t *wakeups_timeout = Stats::get_stats()->counter("wakeups_timeout");
+  static Latency *dispatch_latency = Stats::get_stats()->latency("dispatch");
 
   while(running) {
     // Update timeout and run timeout events
     now_in_msecs = get_time_milliseconds();
     timeout_msecs = -1;
-    for(auto item : m_panel_items) {
+    for(size_t n = 0; n < m_panel_items.size(); n++) {
+      const std::shared_ptr<PanelItem> & item = m_panel_items[n];
       long item_timeout = item->next_time_timeout(now_in_msecs);
       if(item_timeout >= 0) {
         if(now_in_msecs >= item_timeout) {
+          if(EventRecorder::recording())
+            EventRecorder::get_recorder()->record("timeout", n, now_in_msecs);
+          set_frame_cause(FrameCause::TIMER);
+          TRACE_SCOPE("PanelItem::on_timeout");
           item->on_timeout(now_in_msecs);
           item_timeout = item->next_time_timeout(now_in_msecs);
         }
@@ -536,22 +1270,44 @@ void Panel::run()
     }
     debug << "Timeout " << timeout_msecs << std::endl;
     // Repaint interface
-    if(m_repaint_full)
-      draw();
-    else if(m_repaint_partial)
-      draw(-1, true);
+    paint_pending();
     // Proccess pending Wayland events
-    display.dispatch_pending();
-    display.flush();
-    m_repaint_full = m_repaint_partial = false;
-    // Wait for events
-    ret = poll(fds, sizeof(fds) / sizeof(fds[0]), timeout_msecs);
+    {
+      TRACE_SCOPE("wl_display_dispatch_pending");
+      display.dispatch_pending();
+    }
+    {
+      TRACE_SCOPE("wl_display_flush");
+      display.flush();
+    }
+    m_presentation_feedbacks.remove_if([](const PresentationFeedback & feedback) {
+      return feedback.done;
+    });
+    m_repaint_full = m_repaint_partial = m_repaint_scroll = false;
+    // Events that haven't repainted the panel aren't causes of the next frame
+    m_frame_cause = FrameCause::NONE;
+    FrameArena::get_arena()->reset();
+    EventRecorder::get_recorder()->flush();
+    // Wait for events from Wayland display and from items
+    fds.clear();
+    fds.push_back({display.get_fd(), POLLIN, 0});
+    EventLoop::get_pollfds(fds);
+    {
+      TRACE_SCOPE("poll");
+      ret = poll(fds.data(), fds.size(), timeout_msecs);
+    }
+    (*wakeups)++;
     if(ret > 0) {
       if(fds[0].revents) {
+        TRACE_SCOPE("wl_display_dispatch");
+        ScopedLatency timer(dispatch_latency);
         display.dispatch();
-        fds[0].revents = 0;
       }
+      // Callbacks which repaint the panel set the cause of the frame
+      for(size_t n = 1; n < fds.size(); n++)
+        EventLoop::dispatch(fds[n]);
     } else if(ret == 0) {
+      (*wakeups_timeout)++;
       debug << "Timeout\n";
       //for(auto item : m_panel_items) {
       //  item->on_timeout();
@@ -563,6 +1319,178 @@ void Panel::run()
 }
 
 
+/** Panel is drawn in a cairo image surface instead of a Wayland buffer.
+ */
+void Panel::init_headless()
+{
+  m_width = m_height = Settings::get_settings()->panel_size();
+  m_group_toplevels = Settings::get_settings()->group_toplevels();
+  resize_headless(m_width, m_height);
+}
+
+void Panel::resize_headless(uint32_t width, uint32_t height)
+{
+  if(cairo_surface != nullptr)
+    cairo_surface_destroy(cairo_surface);
+  m_width = width;
+  m_height = height;
+  cairo_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, m_width, m_height);
+  m_repaint_full = true;
+}
+
+static std::vector<zwlr_foreign_toplevel_handle_v1_state> parse_states(const std::string & text)
+{
+  std::vector<zwlr_foreign_toplevel_handle_v1_state> states;
+  size_t start = 0;
+  while(start < text.size()) {
+    size_t end = text.find(',', start);
+    if(end == std::string::npos)
+      end = text.size();
+    states.push_back((zwlr_foreign_toplevel_handle_v1_state)std::stoul(text.substr(start, end - start)));
+    start = end + 1;
+  }
+  return states;
+}
+
+/** Sends a recorded event to the same methods used by Wayland listeners.
+ *  toplevels has the buttons created by recorded "toplevel" events.
+ */
+void Panel::replay_event(const RecordedEvent & event, std::unordered_map<int, ToplevelButton *> & toplevels)
+{
+  if(event.name == "motion")
+    pointer_motion(event.get_double(0), event.get_double(1));
+  else if(event.name == "enter")
+    pointer_enter(event.get_double(0), event.get_double(1));
+  else if(event.name == "leave")
+    pointer_leave();
+  else if(event.name == "button")
+    pointer_button(event.get_int(0), event.get_int(1) != 0);
+  else if(event.name == "axis_discrete")
+    pointer_scroll_discrete(event.get_int(0));
+  else if(event.name == "axis")
+    pointer_scroll(event.get_double(0));
+  else if(event.name == "output_mode")
+    m_width = event.get_int(0);
+  else if(event.name == "configure") {
+    uint32_t width = event.get_int(0), height = event.get_int(1);
+    if(width != m_width || height != m_height)
+      resize_headless(width, height);
+  } else if(event.name == "timeout") {
+    // Timers of items only run when recorded, with the recorded time
+    size_t item = event.get_int(0);
+    if(item < m_panel_items.size()) {
+      set_frame_cause(FrameCause::TIMER);
+      m_panel_items[item]->on_timeout(event.get_long(1));
+    } else
+      debug_error << "Unknown item in event timeout" << std::endl;
+  } else if(event.name == "toplevel")
+    toplevels[event.get_int(0)] = on_toplevel_listener(zwlr_foreign_toplevel_handle_v1_t());
+  else if(event.name == "global" || event.name == "global_remove")
+    ; // Wayland interfaces aren't used by headless panels
+  else {
+    // Toplevel events
+    auto it = toplevels.find(event.get_int(0));
+    if(it == toplevels.end()) {
+      debug_error << "Unknown toplevel in event " << event.name << std::endl;
+      return;
+    }
+    ToplevelButton *toplevel = it->second;
+    if(event.name == "title")
+      toplevel->on_title(event.get_string(1));
+    else if(event.name == "app_id")
+      toplevel->on_app_id(event.get_string(1));
+    else if(event.name == "state")
+      toplevel->on_state(parse_states(event.get_string(1)));
+    else if(event.name == "done")
+      toplevel->on_done();
+    else if(event.name == "closed") {
+      toplevels.erase(it);
+      toplevel->on_closed();
+    } else
+      debug_error << "Unknown event " << event.name << std::endl;
+  }
+}
+
+static uint64_t cpu_time_usecs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool Panel::replay(const std::string & path, bool realtime)
+{
+  static uint64_t *frames = Stats::get_stats()->counter("frames");
+  static Latency *present_latency = Stats::get_stats()->latency("commit_to_present");
+  static uint64_t *discarded = Stats::get_stats()->counter("frames_discarded");
+
+  EventReader reader(path);
+  if(!reader.is_open()) {
+    debug_error << "Events file " << path << " cannot be read" << std::endl;
+    return false;
+  }
+  init_headless();
+  // Icons of toplevels depend on the index, so it must be finished before first event
+  IconIndex::get_index()->wait();
+  paint_pending();
+  present_headless_frame();
+  m_repaint_full = m_repaint_partial = m_repaint_scroll = false;
+
+  // Item timers aren't run, only recorded timeouts, so the same file 
+  // always draws the same frames
+  std::unordered_map<int, ToplevelButton *> toplevels;
+  RecordedEvent event;
+  uint64_t events = 0;
+  uint64_t frames_start = *frames;
+  uint64_t presented_start = present_latency->count;
+  uint64_t discarded_start = *discarded;
+  uint64_t allocations_start = allocation_count();
+  uint64_t cpu_start = cpu_time_usecs();
+  uint64_t start = Stats::now_usecs();
+  while(reader.next(event)) {
+    if(realtime) {
+      uint64_t now = Stats::now_usecs();
+      if(start + event.usecs > now)
+        usleep(start + event.usecs - now);
+    }
+    events++;
+    replay_event(event, toplevels);
+    paint_pending();
+    // Frame callbacks are not waited, whole scroll animation is drawn
+    while(m_scrolling)
+      scroll_toplevels();
+    // Each event is followed by a vblank
+    present_headless_frame();
+    m_repaint_full = m_repaint_partial = m_repaint_scroll = false;
+    m_frame_cause = FrameCause::NONE;
+    FrameArena::get_arena()->reset();
+  }
+  uint64_t wall = Stats::now_usecs() - start;
+  uint64_t cpu = cpu_time_usecs() - cpu_start;
+  uint64_t allocations = allocation_count() - allocations_start;
+  uint64_t replay_frames = *frames - frames_start;
+
+  std::cout << "Events: " << events << std::endl
+    << "Wall time: " << wall / 1000.0 << " ms" << std::endl
+    << "CPU time: " << cpu / 1000.0 << " ms" << std::endl
+    << "Frames: " << replay_frames << std::endl
+    << "Presented: " << present_latency->count - presented_start << std::endl
+    << "Discarded: " << *discarded - discarded_start << std::endl
+    << "Allocations: " << allocations;
+  if(replay_frames > 0)
+    std::cout << " (" << allocations / replay_frames << " per frame)";
+  std::cout << std::endl;
+#ifdef ALLOCATION_AUDIT
+  // Replays of hover or clock sessions are used as tests of the steady state
+  // Only allocations made by this thread are audited
+  uint64_t failures = AllocationAudit::failures();
+  std::cout << "Allocation audit failures: " << failures << std::endl;
+  if(failures > 0)
+    return false;
+#endif
+  return true;
+}
+
 void Panel::draw_tooltip(int width, int height)
 {
   if(!tooltip_surface || !tooltip_shared_mem)
@@ -578,14 +1506,11 @@ void Panel::draw_tooltip(int width, int height)
     }
   }
 
-  Color color = Settings::get_settings()->color();
-  Color background_color = Settings::get_settings()->background_color();
-
   cairo_t *cr = cairo_create(tooltip_cairo_surface);
-  cairo_set_source_rgba (cr, color.red, color.green, color.blue, 0);
+  cairo_set_source_rgba (cr, 0, 0, 0, 0);
   cairo_paint(cr);
 
-  cairo_set_source_rgba (cr, color.red, color.green, color.blue, 1.0);
+  cairo_set_source(cr, Style::get_style()->foreground());
   cairo_rectangle (cr, 0, 0, width, height);
   cairo_fill(cr);
   cairo_paint(cr);
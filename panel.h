@@ -26,9 +26,15 @@
 #include <toplevel.h>
 #include "button.h"
 #include "toplevelbutton.h"
+#include "toplevelgroup.h"
+#include "sysfswatch.h"
 #include "tooltip.h"
+#include "eventrecorder.h"
 
 #include <memory>
+#include <unordered_map>
+#include <list>
+#include <time.h>
 
 using namespace wayland;
 
@@ -48,12 +54,25 @@ public:
   ~Panel() noexcept = default;
   Panel& operator=(const Panel&) = delete;
   Panel& operator=(Panel&&) noexcept = delete;
-  Panel();
+  /** If headless is true, panel doesn't connect to Wayland compositor. 
+   *  It can only be used to replay events.
+   */
+  Panel(bool headless = false);
 
   void init();
   void run();
+  /** Replays events saved with EventRecorder and shows CPU time,
+   *  frames and allocations. Panel is drawn in memory.
+   *  If realtime is false, events are sent as fast as possible.
+   */
+  bool replay(const std::string & path, bool realtime);
 
-  void add_launcher(const std::string & icon, const std::string & text, const std::string & tooltip, const std::string & exec, bool start_pos = true);
+  /** Called by Settings before an item is added. If settings are being
+   *  reloaded and an item was built from the same config, that item is 
+   *  kept and true is returned. Otherwise next added item gets config.
+   */
+  bool keep_item(const std::string & config);
+  void add_launcher(const std::string & icon, const std::string & text, const std::string & tooltip, const std::string & exec, bool persistent, bool start_pos = true);
   void add_clock(const std::string & icon, const std::string & format, const std::string & exec, bool start_pos = true);
   void add_battery(
      const std::string & icon_battery_full,    
@@ -65,12 +84,105 @@ public:
      const std::string & icon_battery_charged, 
      bool no_text,
      const std::string & exec, bool start_pos = true);
+  void add_script(const std::string & icon, const std::string & command, const std::string & exec, int min_interval, int restart_interval, bool start_pos = true);
+  void add_system_monitor(int interval, int width, const std::string & exec, bool start_pos = true);
+  void add_perf(int interval, int width, const std::string & exec, bool start_pos = true);
+  void add_network(const std::string & icon_wireless, const std::string & icon_wired, const std::string & icon_offline, const std::string & exec, bool start_pos = true);
+  void add_sysfs(
+     const std::string & path,
+     const std::string & max_path,
+     double scale,
+     int decimals,
+     int interval,
+     const std::string & text,
+     const std::string & tooltip,
+     const std::vector<SysfsThreshold> & thresholds,
+     const std::string & exec, bool start_pos = true);
   void show_tooltip();
+  /** Searches icons of windows again, when desktop files have been indexed.
+   */
+  void update_toplevel_icons();
+  /** Indexes icons for the current icon theme and panel size. Icons
+   *  found before are forgotten. When index is ready, icons of windows
+   *  are searched again.
+   */
+  void rebuild_icon_index();
 
 
 private:
+  /** Events which make the panel to be repainted.
+   */
+  enum class FrameCause {NONE, POINTER, TIMER, EVENT, TOPLEVEL};
+  /*! \struct PresentationFeedback
+   *  \brief Frame which is waiting for the compositor to show it.
+   */
+  struct PresentationFeedback
+  {
+    presentation_feedback_t feedback;
+    uint64_t commit_usecs;
+    bool done;
+  };
+
+  void add_item(std::shared_ptr<PanelItem> item);
   void draw(uint32_t serial = 0, bool update_items_only = false);
-  void on_toplevel_listener(zwlr_foreign_toplevel_handle_v1_t handle);
+  void paint_pending();
+  void scroll_toplevels();
+  void damage(int x, int y, int width, int height);
+  void set_frame_cause(FrameCause cause);
+  void set_frame_cause(FrameCause cause, uint32_t event_msecs);
+  void commit_frame();
+  void frame_presented(PresentationFeedback & feedback, uint64_t present_usecs);
+  void frame_discarded(PresentationFeedback & feedback);
+  void present_headless_frame();
+  ToplevelButton *on_toplevel_listener(zwlr_foreign_toplevel_handle_v1_t handle);
+
+  // Pointer events
+  void pointer_enter(double x, double y);
+  void pointer_leave();
+  void pointer_motion(double x, double y);
+  void pointer_button(uint32_t button, bool pressed);
+  void pointer_scroll_discrete(int32_t discrete);
+  void pointer_scroll(double value);
+
+  // Settings file changes
+  void watch_settings();
+  void reload_settings();
+  void set_group_toplevels(bool group);
+  void configure_layer_surface();
+  void resize_buffers();
+
+  // Replay of recorded events
+  void init_headless();
+  void resize_headless(uint32_t width, uint32_t height);
+  void replay_event(const RecordedEvent & event, std::unordered_map<int, ToplevelButton *> & toplevels);
+
+  void add_to_toplevel_group(ToplevelButton *toplevel);
+  void remove_from_toplevel_group(ToplevelButton *toplevel, const std::string & app_id);
+
+  /** Calls f for each button shown in the toplevels area: 
+   *  groups if toplevels are grouped, windows otherwise.
+   */
+  template<typename F> void for_each_toplevel_item(F f)
+  {
+    if(m_group_toplevels) {
+      for(const std::shared_ptr<ToplevelGroup> & item : m_toplevel_groups_order)
+        f(item.get());
+    } else {
+      m_toplevel_handles.buttons.for_each([&](const std::shared_ptr<ToplevelButton> & item) {
+        f(item.get());
+      });
+    }
+  }
+
+  /** Calls f for each button shown in the toplevels area which is on screen.
+   */
+  template<typename F> void for_each_visible_toplevel_item(F f)
+  {
+    for_each_toplevel_item([&](Button *item) {
+      if(item->get_x() + item->get_width() > m_toplevels_x_start && item->get_x() < m_toplevels_x_end)
+        f(item);
+    });
+  }
 
   // global objects
   display_t display;
@@ -80,6 +192,7 @@ private:
   xdg_wm_base_t xdg_wm_base;
   seat_t seat;
   shm_t shm;
+  presentation_t presentation;
 
   // local objects
   surface_t surface;
@@ -95,7 +208,11 @@ private:
   zwlr_layer_shell_v1_t layer_shell;
   zwlr_layer_surface_v1_t layer_shell_surface;
   zwlr_foreign_toplevel_manager_v1_t toplevel_manager;
-  std::vector<std::shared_ptr<ToplevelButton> > m_toplevel_handles;
+  ToplevelList m_toplevel_handles;
+  // Groups of toplevels by application id. Keys are interned application ids.
+  bool m_group_toplevels;
+  std::unordered_map<const std::string *, std::shared_ptr<ToplevelGroup> > m_toplevel_groups;
+  std::vector<std::shared_ptr<ToplevelGroup> > m_toplevel_groups_order;
   output_t output;
   cairo_surface_t *cairo_surface;
 
@@ -111,8 +228,20 @@ private:
 
   uint32_t m_width, m_height;
   std::vector<std::shared_ptr<PanelItem> > m_panel_items;
+  // Items of settings being reloaded which haven't been kept yet. Keys are configs.
+  std::unordered_multimap<std::string, std::shared_ptr<PanelItem> > m_previous_items;
+  std::string m_item_config; // Config of next added item
+  int m_settings_fd; // inotify of settings directory
   uint32_t m_last_cursor_x, m_last_cursor_y;
-  uint32_t m_toplevel_items_offset;
+  Button *m_hovered_toplevel; // Toplevel item under the pointer or nullptr
+  int m_toplevel_items_offset; // Scroll of toplevels area, when toplevels don't fit
+  int m_toplevels_x_start, m_toplevels_x_end; // Visible part of toplevels area
+  int m_toplevel_scroll_target; // Offset where scroll animation ends
+  int m_axis_discrete; // Wheel steps of the current axis event
+  FrameCause m_frame_cause; // First event since last commit
+  uint64_t m_frame_cause_usecs;
+  clockid_t m_presentation_clock;
+  std::list<PresentationFeedback> m_presentation_feedbacks;
 
   std::shared_ptr<shared_mem_t> shared_mem;
   std::array<buffer_t, 2> buffer;
@@ -125,6 +254,8 @@ private:
   bool has_keyboard;
   bool m_repaint_full;
   bool m_repaint_partial;
+  bool m_repaint_scroll; // Next frame of scroll animation must be drawn
+  bool m_scrolling;
 };
 
 #endif
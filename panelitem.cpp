@@ -16,7 +16,9 @@
 #include "debug.h"
 #include "panelitem.h"
 #include "settings.h"
+#include "style.h"
 #include "tooltip.h"
+#include "trace.h"
 #include <stdio.h>
 
 
@@ -29,6 +31,7 @@ PanelItem::PanelItem()
   m_start_position = true;
   m_timeout_msecs = -1;
   m_next_time_timeout = -1;
+  m_last_timeout = 0;
 }
 
 void PanelItem::set_pos(int x, int y)
@@ -72,6 +75,16 @@ bool PanelItem::get_selected()
   return m_selected;
 }
 
+const std::string & PanelItem::get_config()
+{
+  return m_config;
+}
+
+void PanelItem::set_config(const std::string & config)
+{
+  m_config = config;
+}
+
 bool PanelItem::is_start_pos()
 {
   return m_start_position;
@@ -106,18 +119,18 @@ bool PanelItem::is_in(int x, int y)
 
 void PanelItem::repaint(cairo_t *cr)
 {
-  Color color = Settings::get_settings()->color();
-  Color background_color = Settings::get_settings()->background_color();
+  TRACE_SCOPE("PanelItem::repaint");
+  std::shared_ptr<const Style> style = Style::get_style();
 
   if(m_mouse_clicked)
-    cairo_set_source_rgba (cr, 1.0 - color.red, 1.0 - color.green, 1.0 - color.blue, 1.0);
+    cairo_set_source(cr, style->pressed());
   else if(m_mouse_over) {
-    cairo_set_source_rgba (cr, background_color.red, background_color.green, background_color.blue, 1.0);
+    cairo_set_source(cr, style->background());
     cairo_rectangle(cr, m_x, m_y, m_width, m_height);
     cairo_fill(cr);
-    cairo_set_source_rgba (cr, color.red, color.green, color.blue, 0.3);
+    cairo_set_source(cr, style->hover());
   } else
-    cairo_set_source_rgba (cr, background_color.red, background_color.green, background_color.blue, 1.0);
+    cairo_set_source(cr, style->background());
   cairo_rectangle(cr, m_x, m_y, m_width, m_height);
   cairo_fill(cr);
 
@@ -125,7 +138,7 @@ void PanelItem::repaint(cairo_t *cr)
   paint(cr);
 
   if(m_selected) {
-    cairo_set_source_rgba (cr, 1.0 - color.red, 1.0 - color.green, 1.0 - color.blue, 0.3);
+    cairo_set_source(cr, style->selected());
     cairo_rectangle(cr, m_x, m_y, m_width, m_height);
     cairo_fill(cr);
   }
@@ -177,6 +190,7 @@ void PanelItem::on_mouse_enter(int x, int y)
 void PanelItem::on_timeout(long now_in_msecs)
 {
   if(now_in_msecs > m_next_time_timeout) {
+    m_last_timeout = now_in_msecs;
     timeout();
     m_next_time_timeout = now_in_msecs + m_timeout_msecs;
   }
@@ -41,6 +41,11 @@ public:
   void set_selected(bool selected);
   bool is_start_pos();
   void set_start_pos(bool pos);
+  /** Settings used to build the item. Items with the same config
+   *  are kept when settings are reloaded.
+   */
+  const std::string & get_config();
+  void set_config(const std::string & config);
 
   void repaint(cairo_t *cr);
 
@@ -82,6 +87,9 @@ protected:
 
   int m_timeout_msecs;
   long m_next_time_timeout;
+  long m_last_timeout; /*!< Time of the current timeout, in milliseconds. Replayed timeouts have the recorded time. */
+
+  std::string m_config;
 };
 
 #endif
@@ -0,0 +1,146 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "perfhud.h"
+#include "style.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+/** Returns true if value is different enough from the value shown.
+ *  Changes up to dead_band are ignored.
+ */
+static bool perf_hud_changed(double shown, double value, double dead_band)
+{
+  return fabs(value - shown) > fmax(PERF_HUD_THRESHOLD * fabs(shown), dead_band);
+}
+
+/** Hit rate in [0, 1] or -1 if there aren't hits nor misses.
+ */
+static double perf_hud_hit_rate(uint64_t hits, uint64_t misses)
+{
+  if(hits + misses == 0)
+    return -1.0;
+  return (double)hits / (double)(hits + misses);
+}
+
+PerfHud::PerfHud(int interval, int width) : ButtonRunCommand()
+{
+  Stats *stats = Stats::get_stats();
+  m_draw = stats->latency("draw");
+  m_wakeups = stats->counter("wakeups");
+  m_icon_hits = stats->counter("icon_cache_hits");
+  m_icon_misses = stats->counter("icon_cache_misses");
+  m_pool_hits = stats->counter("toplevel_pool_hits");
+  m_pool_misses = stats->counter("toplevel_pool_misses");
+
+  m_last_usecs = Stats::now_usecs();
+  m_last_frames = m_draw->count;
+  m_last_frame_usecs = m_draw->total_usecs;
+  m_last_wakeups = *m_wakeups;
+  m_own_frames = 0;
+  m_frame_usecs = m_frames_per_minute = m_wakeups_per_minute = 0.0;
+  m_icon_hit_rate = -1.0;
+  m_shown_frame_usecs = m_shown_frames_per_minute = m_shown_wakeups_per_minute = -1.0;
+  m_shown_icon_hit_rate = -1.0;
+  m_item_width = width;
+
+  sample();
+  set_timeout(interval > 0 ? interval : 1000);
+}
+
+bool PerfHud::sample()
+{
+  uint64_t now = Stats::now_usecs();
+  uint64_t elapsed = now - m_last_usecs;
+  if(elapsed == 0)
+    return false;
+  uint64_t all_frames = m_draw->count - m_last_frames;
+  // Frames drawn because of this item are not measured
+  uint64_t frames = all_frames - std::min(m_own_frames, all_frames);
+  m_own_frames = 0;
+  if(frames > 0)
+    m_frame_usecs = (double)(m_draw->total_usecs - m_last_frame_usecs) / all_frames;
+  m_frames_per_minute = frames * 60e6 / elapsed;
+  m_wakeups_per_minute = (*m_wakeups - m_last_wakeups) * 60e6 / elapsed;
+  m_icon_hit_rate = perf_hud_hit_rate(*m_icon_hits, *m_icon_misses);
+
+  m_last_usecs = now;
+  m_last_frames = m_draw->count;
+  m_last_frame_usecs = m_draw->total_usecs;
+  m_last_wakeups = *m_wakeups;
+
+  m_sparkline.push(m_frame_usecs / PERF_HUD_FRAME_BUDGET_USECS);
+
+  if(!perf_hud_changed(m_shown_frame_usecs, m_frame_usecs, PERF_HUD_DEAD_BAND_FRAME_USECS)
+      && !perf_hud_changed(m_shown_frames_per_minute, m_frames_per_minute, PERF_HUD_DEAD_BAND_PER_MINUTE)
+      && !perf_hud_changed(m_shown_wakeups_per_minute, m_wakeups_per_minute, PERF_HUD_DEAD_BAND_PER_MINUTE)
+      && !perf_hud_changed(m_shown_icon_hit_rate * 100.0, m_icon_hit_rate * 100.0, PERF_HUD_DEAD_BAND_PERCENT))
+    return false;
+
+  m_shown_frame_usecs = m_frame_usecs;
+  m_shown_frames_per_minute = m_frames_per_minute;
+  m_shown_wakeups_per_minute = m_wakeups_per_minute;
+  m_shown_icon_hit_rate = m_icon_hit_rate;
+
+  char text[64];
+  if(m_icon_hit_rate >= 0.0)
+    snprintf(text, sizeof(text), "%.1fms %.0ff\n%.0fw %.0f%%", m_frame_usecs / 1000.0, m_frames_per_minute,
+      m_wakeups_per_minute, m_icon_hit_rate * 100.0);
+  else
+    snprintf(text, sizeof(text), "%.1fms %.0ff\n%.0fw", m_frame_usecs / 1000.0, m_frames_per_minute,
+      m_wakeups_per_minute);
+  set_text(text);
+  return true;
+}
+
+void PerfHud::timeout()
+{
+  if(sample() && send_repaint) {
+    m_own_frames++;
+    send_repaint();
+  }
+}
+
+void PerfHud::mouse_enter()
+{
+  char text[512];
+  int size = snprintf(text, sizeof(text), 
+    "Frame time: %.2f ms (p99 %.2f ms, max %.2f ms)\n"
+    "Frames: %.0f per minute\n"
+    "Wakeups: %.0f per minute",
+    m_frame_usecs / 1000.0, m_draw->percentile(0.99) / 1000.0, m_draw->max_usecs / 1000.0,
+    m_frames_per_minute, m_wakeups_per_minute);
+  double pool_hit_rate = perf_hud_hit_rate(*m_pool_hits, *m_pool_misses);
+  if(m_icon_hit_rate >= 0.0 && size < (int)sizeof(text))
+    size += snprintf(text + size, sizeof(text) - size, "\nIcon cache hits: %.0f%%", m_icon_hit_rate * 100.0);
+  if(pool_hit_rate >= 0.0 && size < (int)sizeof(text))
+    snprintf(text + size, sizeof(text) - size, "\nWindow icon pool hits: %.0f%%", pool_hit_rate * 100.0);
+  show_tooltip(text);
+}
+
+void PerfHud::update_size(cairo_t *cr)
+{
+  m_width = m_item_width;
+}
+
+void PerfHud::paint(cairo_t *cr)
+{
+  const Color & color = Style::get_style()->color();
+  int margin = 2;
+  m_sparkline.paint(cr, m_x + margin, m_y + margin, m_width - 2 * margin, m_height - 2 * margin, color, 0.25);
+  Button::paint(cr);
+}
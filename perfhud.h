@@ -0,0 +1,81 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __PERFHUD_H__
+#define __PERFHUD_H__
+
+#include <string>
+#include <functional>
+#include <stdint.h>
+#include "buttonruncommand.h"
+#include "sparkline.h"
+#include "stats.h"
+
+// Frame time shown as a full bar in the sparkline
+#define PERF_HUD_FRAME_BUDGET_USECS 16667
+// Relative change of a value needed to repaint the item
+#define PERF_HUD_THRESHOLD 0.1
+// Absolute changes ignored, so values near 0 don't repaint the item
+#define PERF_HUD_DEAD_BAND_FRAME_USECS 500.0
+#define PERF_HUD_DEAD_BAND_PER_MINUTE 10.0
+#define PERF_HUD_DEAD_BAND_PERCENT 1.0
+
+/*! \class PerfHud
+ *  \brief Item that shows panel performance from Stats.
+ *
+ *  Each interval the average frame time, frames and wakeups per minute 
+ *  and the icon cache hit rate are computed. Frame times are drawn in a
+ *  sparkline. The item is only repainted when a value changes more than
+ *  PERF_HUD_THRESHOLD and the dead band of the value, so it doesn't cause
+ *  most of the frames it measures. Frames caused by its own repaints
+ *  are not counted.
+ *  The tooltip shows all values.
+ *
+ *  As ButtonRunCommand child a command can be run when
+ *  item is clicked.
+ */
+class PerfHud : public ButtonRunCommand
+{
+public:
+  /** \param interval milliseconds between samples.
+   *  \param width width of the item. 
+   */
+  PerfHud(int interval, int width);
+
+  /** Reads stats. Returns true if item must be repainted. */
+  bool sample();
+
+  virtual void timeout() override;
+  virtual void mouse_enter() override;
+  virtual void paint(cairo_t *cr) override;
+  virtual void update_size(cairo_t *cr) override;
+
+  std::function<void()> send_repaint;
+
+private:
+  Latency *m_draw;
+  uint64_t *m_wakeups;
+  uint64_t *m_icon_hits, *m_icon_misses, *m_pool_hits, *m_pool_misses;
+
+  uint64_t m_last_usecs, m_last_frames, m_last_frame_usecs, m_last_wakeups;
+  uint64_t m_own_frames; // Repaints requested by this item since last sample
+  double m_frame_usecs, m_frames_per_minute, m_wakeups_per_minute, m_icon_hit_rate;
+  // Values shown in panel
+  double m_shown_frame_usecs, m_shown_frames_per_minute, m_shown_wakeups_per_minute, m_shown_icon_hit_rate;
+  int m_item_width;
+  Sparkline m_sparkline;
+};
+
+#endif
@@ -0,0 +1,194 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "script.h"
+#include "eventloop.h"
+#include "stats.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+
+// Lines longer than this are truncated
+#define MAX_LINE_SIZE 4096
+
+static long get_time_milliseconds()
+{
+  return Stats::now_usecs() / 1000;
+}
+
+/** Changes "\n" to new lines.
+ */
+static std::string unescape(const std::string & text)
+{
+  std::string out;
+  for(size_t n = 0; n < text.size(); n++) {
+    if(text[n] == '\\' && n + 1 < text.size() && text[n + 1] == 'n') {
+      out += '\n';
+      n++;
+    } else
+      out += text[n];
+  }
+  return out;
+}
+
+Script::Script(const std::string & icon, const std::string & command, int min_interval, int restart_interval) : ButtonRunCommand(icon, std::string(), std::string())
+{
+  m_script.set_command_line(command);
+  m_fd = -1;
+  m_min_interval = min_interval < 0 ? 0 : min_interval;
+  m_restart_interval = restart_interval;
+  m_last_repaint = 0;
+  m_repaint_pending = m_restart_pending = false;
+}
+
+Script::~Script()
+{
+  stop();
+  // Script runs in its own session. Whole process group is terminated,
+  // not only /bin/sh. Process is not signalled if it has been reaped.
+  if(m_pid && *m_pid > 0)
+    kill(-*m_pid, SIGTERM);
+}
+
+void Script::start()
+{
+  if(m_fd >= 0 || m_script.empty())
+    return;
+
+  int fds[2];
+  if(pipe2(fds, O_CLOEXEC) < 0) {
+    debug_error << "pipe failed: " << strerror(errno) << std::endl;
+    return;
+  }
+  // Only panel end is non-blocking. Command writes to a blocking pipe.
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+  // Each run has its own pid. It is cleared when child is reaped, so a
+  // recycled pid is never signalled. Pid is shared with the watcher
+  // because it can outlive this item.
+  auto pid = std::make_shared<pid_t>(-1);
+  *pid = m_script.run(-1, fds[1], [pid](int status) {
+    *pid = -1;
+  });
+  close(fds[1]);
+  if(*pid < 0) {
+    close(fds[0]);
+    m_restart_pending = m_restart_interval >= 0;
+    update_timeout();
+    return;
+  }
+
+  m_pid = pid;
+  m_fd = fds[0];
+  EventLoop::add_fd(m_fd, POLLIN, [this](short revents) {
+    read_output();
+  });
+  debug << "Script started: " << m_script.get_command_line() << std::endl;
+}
+
+void Script::stop()
+{
+  if(m_fd >= 0) {
+    EventLoop::remove_fd(m_fd);
+    close(m_fd);
+    m_fd = -1;
+  }
+  m_buffer.clear();
+}
+
+void Script::read_output()
+{
+  char buffer[1024];
+  ssize_t size;
+
+  while((size = read(m_fd, buffer, sizeof(buffer))) > 0) {
+    m_buffer.append(buffer, size);
+    size_t start = 0, end;
+    while((end = m_buffer.find('\n', start)) != std::string::npos) {
+      parse_line(m_buffer.substr(start, end - start));
+      start = end + 1;
+    }
+    m_buffer.erase(0, start);
+    if(m_buffer.size() > MAX_LINE_SIZE) {
+      parse_line(m_buffer.substr(0, MAX_LINE_SIZE));
+      m_buffer.clear();
+    }
+  }
+
+  if(size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+    // Command has finished
+    if(!m_buffer.empty())
+      parse_line(m_buffer);
+    debug << "Script finished: " << m_script.get_command_line() << std::endl;
+    stop();
+    m_restart_pending = m_restart_interval >= 0;
+    update_timeout();
+  }
+}
+
+void Script::parse_line(const std::string & line)
+{
+  if(line.compare(0, 5, "text:") == 0)
+    set_text(unescape(line.substr(5)));
+  else if(line.compare(0, 5, "icon:") == 0)
+    set_icon(line.substr(5));
+  else if(line.compare(0, 8, "tooltip:") == 0)
+    set_tooltip(unescape(line.substr(8)));
+  else
+    set_text(unescape(line));
+  request_repaint();
+}
+
+void Script::request_repaint()
+{
+  long now = get_time_milliseconds();
+  if(now - m_last_repaint >= m_min_interval) {
+    m_last_repaint = now;
+    m_repaint_pending = false;
+    if(send_repaint)
+      send_repaint();
+  } else {
+    // Too many lines. Repaint is delayed.
+    m_repaint_pending = true;
+  }
+  update_timeout();
+}
+
+void Script::update_timeout()
+{
+  if(m_repaint_pending)
+    set_timeout(m_min_interval > 0 ? m_min_interval : 1);
+  else if(m_restart_pending)
+    set_timeout(m_restart_interval > 0 ? m_restart_interval : 1);
+  else
+    set_timeout(-1);
+}
+
+void Script::timeout()
+{
+  if(m_repaint_pending) {
+    m_repaint_pending = false;
+    m_last_repaint = get_time_milliseconds();
+    if(send_repaint)
+      send_repaint();
+  } else if(m_restart_pending) {
+    m_restart_pending = false;
+    start();
+  }
+  update_timeout();
+}
@@ -0,0 +1,72 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __SCRIPT_H__
+#define __SCRIPT_H__
+
+#include <string>
+#include <functional>
+#include <memory>
+#include "buttonruncommand.h"
+#include "command.h"
+
+
+/*! \class Script
+ *  \brief Item that shows the output of a long-running command.
+ *
+ *  The command is started once and its standard output is read from
+ *  the main loop. Each line changes the item:
+ *    text:Text to show
+ *    icon:icon-name
+ *    tooltip:Tooltip text
+ *  A line without one of these prefixes changes the text. "\n" in text
+ *  and tooltips is changed to a new line.
+ *  Repaints are limited to one each min_interval milliseconds.
+ *  If the command ends, it is started again after restart_interval
+ *  milliseconds. If restart_interval is negative, it isn't restarted.
+ *
+ *  As ButtonRunCommand child a command can be run when
+ *  item is clicked.
+ */
+class Script : public ButtonRunCommand
+{
+public:
+  Script(const std::string & icon, const std::string & command, int min_interval, int restart_interval);
+  virtual ~Script();
+
+  /** Starts command. */
+  void start();
+
+  virtual void timeout() override;
+
+  std::function<void()> send_repaint;
+
+private:
+  void stop();
+  void read_output();
+  void parse_line(const std::string & line);
+  void request_repaint();
+  void update_timeout();
+
+  Command m_script;
+  std::shared_ptr<pid_t> m_pid; // Last run. -1 when it has been reaped.
+  int m_fd;
+  std::string m_buffer; // Incomplete line
+  int m_min_interval, m_restart_interval;
+  long m_last_repaint; // In milliseconds
+  bool m_repaint_pending, m_restart_pending;
+};
+
+#endif
@@ -15,8 +15,10 @@
   
 #include "debug.h"
 #include "settings.h"
+#include "style.h"
 #include "panel.h"
 #include "utils.h"
+#include "icons.h"
 #include <json/json.h>
 #include <fstream>
 #include <iostream>
@@ -43,7 +45,12 @@ std::string Settings::get_env(const char * var)
   return std::string();
 }
 
-std::string Settings::icon_theme()
+const std::string & Settings::path()
+{
+  return m_path;
+}
+
+const std::string & Settings::icon_theme()
 {
   return m_icon_theme;
 }
@@ -53,7 +60,7 @@ int Settings::font_size()
   return m_font_size;
 }
 
-std::string Settings::font()
+const std::string & Settings::font()
 {
   return m_font;
 }
@@ -99,6 +106,11 @@ PanelPosition Settings::panel_position()
   return m_panel_position;
 }
 
+bool Settings::group_toplevels()
+{
+  return m_group_toplevels;
+}
+
 Settings::Settings()
 {
   m_icon_theme = "hicolor"; 
@@ -109,17 +121,25 @@ Settings::Settings()
   m_panel_size = 33;
   m_panel_position = PanelPosition::BOTTOM;
   m_exclusive_zone = m_panel_size;
+  m_group_toplevels = false;
 }
 
-static void load_items(const Json::Value &items, Panel *panel, bool start_pos)
+static void load_items(const Json::Value &items, Panel *panel, bool start_pos, const std::string & globals)
 {
+  Json::StreamWriterBuilder writer;
+  writer["indentation"] = "";
   for(Json::Value item : items) {
+    // Items built from the same settings are kept when settings are reloaded
+    std::string config = globals + (start_pos ? "start " : "end ") + Json::writeString(writer, item);
+    if(panel->keep_item(config))
+      continue;
     if(item.get("type", "").asString() == std::string("launcher")) {
       std::string icon = item.get("icon", "").asString();
       std::string exec = item.get("exec", "").asString();
       std::string text = item.get("text", "").asString();
       std::string tooltip = item.get("tooltip", "").asString();
-      panel->add_launcher(icon, text, tooltip, exec, start_pos);
+      std::string mode = item.get("mode", "").asString();
+      panel->add_launcher(icon, text, tooltip, exec, mode == "persistent", start_pos);
     } else if(item.get("type", "").asString() == std::string("clock")) {
       std::string icon = item.get("icon", "").asString();
       std::string exec = item.get("exec", "").asString();
@@ -147,6 +167,48 @@ static void load_items(const Json::Value &items, Panel *panel, bool start_pos)
           icon_battery_charged, 
           no_text != "",
           exec, start_pos);
+    } else if(item.get("type", "").asString() == std::string("script")) {
+      std::string icon = item.get("icon", "").asString();
+      std::string exec = item.get("exec", "").asString();
+      std::string command = item.get("command", "").asString();
+      int min_interval = item.get("min_interval", 100).asInt();
+      int restart_interval = item.get("restart_interval", 5000).asInt();
+      panel->add_script(icon, command, exec, min_interval, restart_interval, start_pos);
+    } else if(item.get("type", "").asString() == std::string("system_monitor")) {
+      std::string exec = item.get("exec", "").asString();
+      int interval = item.get("interval", 1000).asInt();
+      int width = item.get("width", 0).asInt();
+      panel->add_system_monitor(interval, width, exec, start_pos);
+    } else if(item.get("type", "").asString() == std::string("perf")) {
+      std::string exec = item.get("exec", "").asString();
+      int interval = item.get("interval", 1000).asInt();
+      int width = item.get("width", 0).asInt();
+      panel->add_perf(interval, width, exec, start_pos);
+    } else if(item.get("type", "").asString() == std::string("network")) {
+      std::string exec = item.get("exec", "").asString();
+      std::string icon_wireless = item.get("icon_wireless", "network-wireless").asString();
+      std::string icon_wired    = item.get("icon_wired", "network-wired").asString();
+      std::string icon_offline  = item.get("icon_offline", "network-offline").asString();
+      panel->add_network(icon_wireless, icon_wired, icon_offline, exec, start_pos);
+    } else if(item.get("type", "").asString() == std::string("sysfs")) {
+      std::string exec = item.get("exec", "").asString();
+      std::string path = item.get("path", "").asString();
+      std::string max_path = item.get("max_path", "").asString();
+      double scale = item.get("scale", 1.0).asDouble();
+      int decimals = item.get("decimals", 0).asInt();
+      int interval = item.get("interval", 5000).asInt();
+      std::string text = item.get("text", "%v").asString();
+      std::string tooltip = item.get("tooltip", "").asString();
+      std::vector<SysfsThreshold> thresholds;
+      for(Json::Value threshold : item.get("thresholds", Json::Value(Json::arrayValue))) {
+        SysfsThreshold t;
+        t.min = threshold.get("min", 0.0).asDouble();
+        t.equals = threshold.get("equals", "").asString();
+        t.icon = threshold.get("icon", "").asString();
+        t.text = threshold.get("text", "").asString();
+        thresholds.push_back(t);
+      }
+      panel->add_sysfs(path, max_path, scale, decimals, interval, text, tooltip, thresholds, exec, start_pos);
     }
   }
 }
@@ -160,6 +222,39 @@ void Settings::load_settings(const std::string & path, Panel *panel)
 
   json_file >> json;
 
+  // Values are read to a new model. If a value has a wrong type, 
+  // current settings aren't changed.
+  Settings settings;
+  settings.read(json);
+  settings.m_path = path;
+  int icon_cache_size = json.get("icon_cache_size", 4096).asInt();
+  bool reload = !m_path.empty();
+  bool icons_changed = m_icon_theme != settings.m_icon_theme || m_panel_size != settings.m_panel_size;
+  *this = settings;
+  Icon::set_cache_size(icon_cache_size * 1024);
+
+  // Items are built with the new fonts and colors
+  Style::set_style(std::make_shared<const Style>(this));
+
+  // Items are built while icons of the new theme and size are indexed.
+  // Until then, icons are searched in disk.
+  if(reload && icons_changed)
+    panel->rebuild_icon_index();
+
+  // Settings which change the size or the icons of all items
+  std::string globals = m_icon_theme + "\n" + m_font + "\n" + std::to_string(m_font_size) + "\n" + std::to_string(m_panel_size) + "\n";
+
+  const Json::Value start_items = json["start_items"];
+  if(start_items != Json::ValueType::nullValue) 
+    load_items(start_items, panel, true, globals);
+
+  const Json::Value end_items = json["end_items"];
+  if(end_items != Json::ValueType::nullValue) 
+    load_items(end_items, panel, false, globals);
+}
+
+void Settings::read(const Json::Value & json)
+{
   m_icon_theme = json.get("icon_theme", "").asString();
   if(m_icon_theme.empty()) {
     // Load default icon theme
@@ -181,6 +276,8 @@ void Settings::load_settings(const std::string & path, Panel *panel)
   m_exclusive_zone = json.get("exclusive_zone", m_panel_size).asInt();
   debug << "exclusive_zone " << m_exclusive_zone << std:: endl;
 
+  m_group_toplevels = json.get("group_toplevels", false).asBool();
+
   const Json::Value color = json["color"];
   if(color != Json::ValueType::nullValue) {
     m_color.red = color[0].asFloat();
@@ -202,12 +299,4 @@ void Settings::load_settings(const std::string & path, Panel *panel)
     m_background_color.green = 0.9;
     m_background_color.blue = 1;
   }
-
-  const Json::Value start_items = json["start_items"];
-  if(start_items != Json::ValueType::nullValue) 
-    load_items(start_items, panel, true);
-
-  const Json::Value end_items = json["end_items"];
-  if(end_items != Json::ValueType::nullValue) 
-    load_items(end_items, panel, false);
 }
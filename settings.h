@@ -19,6 +19,7 @@
 #include <string>
 
 class Panel;
+namespace Json { class Value; }
 
 struct Color {
   float red, green, blue;
@@ -34,6 +35,8 @@ enum PanelPosition {
  *  Example:
  *  Settings *s = Settings::get_settings();
  *  s->load_settings("path to file", panel);
+ *  If a value has a wrong type, an exception is thrown and settings
+ *  aren't changed. Items added before the error aren't removed.
  *  Color color = s->color();
  *  ...
  */
@@ -45,13 +48,16 @@ class Settings
     /** Load settings from file path.
      */
     void load_settings(const std::string & path, Panel *panel);
+    /** Path of last file loaded.
+     */
+    const std::string & path();
     static std::string home_path();
     /** Gets enviroment variable.
      */
     static std::string get_env(const char *var);
 
-    std::string icon_theme();
-    std::string font();
+    const std::string & icon_theme();
+    const std::string & font();
     int font_size();
 
     Color color();
@@ -65,8 +71,16 @@ class Settings
 
     PanelPosition panel_position();
 
+    /** If true, windows of the same application are shown in one button.
+     */
+    bool group_toplevels();
+
   private:
+   /** Reads values of json, but not items. */
+   void read(const Json::Value & json);
+
    static Settings m_settings; // Unique instance of settings
+   std::string m_path;
    std::string m_icon_theme;
    std::string m_font;
    int m_font_size;
@@ -75,6 +89,7 @@ class Settings
    int m_panel_size;
    int m_exclusive_zone;
    PanelPosition m_panel_position;
+   bool m_group_toplevels;
 };
 
 #endif
@@ -0,0 +1,157 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __SLOTMAP_H__
+#define __SLOTMAP_H__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*! \struct SlotHandle
+ *  \brief Stable reference to an element of a SlotMap.
+ *
+ *  A handle is invalid after its element is removed, even if the slot
+ *  is reused: generation is incremented each time a slot is freed.
+ */
+struct SlotHandle
+{
+  uint32_t index = UINT32_MAX;
+  uint32_t generation = 0;
+};
+
+/*! \class SlotMap
+ *  \brief Container with O(1) insert and remove that keeps insertion order.
+ *
+ *  Values are stored in a dense vector in insertion order, so iteration is
+ *  cache friendly and order of items in panel doesn't change.
+ *  Removed values leave a hole that is skipped when iterating. When there
+ *  are more holes than values, the dense vector is compacted (amortized O(1)).
+ *  Handles point to slots, which point to the position in the dense vector,
+ *  so handles stay valid after compaction.
+ *
+ *  Example:
+ *    SlotMap<std::shared_ptr<ToplevelButton> > map;
+ *    SlotHandle handle = map.insert(button);
+ *    map.for_each([](std::shared_ptr<ToplevelButton> & b) {...});
+ *    map.remove(handle);
+ */
+template<typename T> class SlotMap
+{
+public:
+  SlotHandle insert(const T & value)
+  {
+    uint32_t index;
+    if(m_free_slots.empty()) {
+      index = m_slots.size();
+      m_slots.push_back(Slot());
+    } else {
+      index = m_free_slots.back();
+      m_free_slots.pop_back();
+    }
+    m_slots[index].dense = m_values.size();
+    m_values.push_back(value);
+    m_dense_to_slot.push_back(index);
+    m_size++;
+    return SlotHandle{index, m_slots[index].generation};
+  }
+
+  /** Removes value. Returns false if handle isn't valid.
+   */
+  bool remove(SlotHandle handle)
+  {
+    if(!valid(handle))
+      return false;
+    Slot & slot = m_slots[handle.index];
+    m_values[slot.dense] = T();
+    m_dense_to_slot[slot.dense] = HOLE;
+    slot.dense = HOLE;
+    slot.generation++;
+    m_free_slots.push_back(handle.index);
+    m_size--;
+    if(m_values.size() > 16 && m_values.size() - m_size > m_size)
+      compact();
+    return true;
+  }
+
+  bool valid(SlotHandle handle) const
+  {
+    return handle.index < m_slots.size() 
+      && m_slots[handle.index].generation == handle.generation
+      && m_slots[handle.index].dense != HOLE;
+  }
+
+  /** Returns nullptr if handle isn't valid.
+   */
+  T *get(SlotHandle handle)
+  {
+    return valid(handle) ? &m_values[m_slots[handle.index].dense] : nullptr;
+  }
+
+  size_t size() const
+  {
+    return m_size;
+  }
+
+  bool empty() const
+  {
+    return m_size == 0;
+  }
+
+  /** Calls f(T &) for each value in insertion order.
+   *  Values must not be inserted or removed from f.
+   */
+  template<typename F> void for_each(F f)
+  {
+    for(size_t i = 0; i < m_values.size(); i++) {
+      if(m_dense_to_slot[i] != HOLE)
+        f(m_values[i]);
+    }
+  }
+
+private:
+  static constexpr uint32_t HOLE = UINT32_MAX;
+
+  struct Slot
+  {
+    uint32_t dense = HOLE; // Position in m_values
+    uint32_t generation = 0;
+  };
+
+  void compact()
+  {
+    size_t n = 0;
+    for(size_t i = 0; i < m_values.size(); i++) {
+      if(m_dense_to_slot[i] == HOLE)
+        continue;
+      if(n != i) {
+        m_values[n] = std::move(m_values[i]);
+        m_dense_to_slot[n] = m_dense_to_slot[i];
+        m_slots[m_dense_to_slot[n]].dense = n;
+      }
+      n++;
+    }
+    m_values.resize(n);
+    m_dense_to_slot.resize(n);
+  }
+
+  std::vector<Slot> m_slots;
+  std::vector<uint32_t> m_free_slots;
+  std::vector<T> m_values;
+  std::vector<uint32_t> m_dense_to_slot;
+  size_t m_size = 0;
+};
+
+#endif
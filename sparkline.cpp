@@ -0,0 +1,122 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "sparkline.h"
+#include <string.h>
+
+Sparkline::Sparkline()
+{
+  m_samples.fill(0.0);
+  m_head = m_count = 0;
+  m_surface = nullptr;
+  m_width = m_height = 0;
+  m_pixel = 0;
+}
+
+Sparkline::~Sparkline()
+{
+  if(m_surface != nullptr)
+    cairo_surface_destroy(m_surface);
+}
+
+float Sparkline::last()
+{
+  if(m_count == 0)
+    return 0.0;
+  return m_samples[(m_head + SPARKLINE_MAX_SAMPLES - 1) % SPARKLINE_MAX_SAMPLES];
+}
+
+void Sparkline::push(float value)
+{
+  if(value < 0.0) value = 0.0;
+  if(value > 1.0) value = 1.0;
+  m_samples[m_head] = value;
+  m_head = (m_head + 1) % SPARKLINE_MAX_SAMPLES;
+  if(m_count < SPARKLINE_MAX_SAMPLES)
+    m_count++;
+
+  if(m_surface == nullptr)
+    return;
+
+  // Scroll cached image one column and draw only the new column
+  cairo_surface_flush(m_surface);
+  unsigned char *data = cairo_image_surface_get_data(m_surface);
+  int stride = cairo_image_surface_get_stride(m_surface);
+  for(int y = 0; y < m_height; y++) {
+    unsigned char *row = data + y * stride;
+    memmove(row, row + 4, (m_width - 1) * 4);
+  }
+  draw_column(m_width - 1, value);
+  cairo_surface_mark_dirty(m_surface);
+}
+
+void Sparkline::draw_column(int column, float value)
+{
+  unsigned char *data = cairo_image_surface_get_data(m_surface);
+  int stride = cairo_image_surface_get_stride(m_surface);
+  int top = m_height - (int)(value * m_height + 0.5);
+  for(int y = 0; y < m_height; y++) {
+    uint32_t *pixel = (uint32_t*)(data + y * stride) + column;
+    *pixel = y >= top ? m_pixel : 0;
+  }
+}
+
+void Sparkline::render()
+{
+  cairo_surface_flush(m_surface);
+  // Newest sample is at the right border
+  for(int column = 0; column < m_width; column++) {
+    size_t age = m_width - 1 - column;
+    float value = 0.0;
+    if(age < m_count)
+      value = m_samples[(m_head + SPARKLINE_MAX_SAMPLES - 1 - age) % SPARKLINE_MAX_SAMPLES];
+    draw_column(column, value);
+  }
+  cairo_surface_mark_dirty(m_surface);
+}
+
+void Sparkline::paint(cairo_t *cr, int x, int y, int width, int height, const Color & color, float alpha)
+{
+  if(width > SPARKLINE_MAX_SAMPLES)
+    width = SPARKLINE_MAX_SAMPLES;
+  if(width <= 0 || height <= 0)
+    return;
+
+  uint32_t a = alpha * 255;
+  uint32_t pixel = (a << 24)
+    | ((uint32_t)(color.red * a) << 16)
+    | ((uint32_t)(color.green * a) << 8)
+    | (uint32_t)(color.blue * a);
+
+  if(m_surface == nullptr || width != m_width || height != m_height || pixel != m_pixel) {
+    if(m_surface != nullptr)
+      cairo_surface_destroy(m_surface);
+    m_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    if(cairo_surface_status(m_surface) != CAIRO_STATUS_SUCCESS) {
+      debug_error << "cairo_surface cannot be created: " << cairo_status_to_string(cairo_surface_status(m_surface)) << std::endl;
+      cairo_surface_destroy(m_surface);
+      m_surface = nullptr;
+      return;
+    }
+    m_width = width;
+    m_height = height;
+    m_pixel = pixel;
+    render();
+  }
+
+  cairo_set_source_surface(cr, m_surface, x, y);
+  cairo_paint(cr);
+}
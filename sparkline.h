@@ -0,0 +1,64 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __SPARKLINE_H__
+#define __SPARKLINE_H__
+
+#include <cairo/cairo.h>
+#include <array>
+#include <stdint.h>
+#include "settings.h"
+
+#define SPARKLINE_MAX_SAMPLES 256
+
+/*! \class Sparkline
+ *  \brief Small bar graph of the last samples.
+ *
+ *  Samples are stored in a fixed-size ring buffer. The graph is rendered
+ *  into a cached image: when a sample is added, the cached image is
+ *  scrolled one column to the left and only the new column is drawn.
+ *  The whole image is only rendered again if its size or color changes.
+ *  Example:
+ *    Sparkline sparkline;
+ *    sparkline.push(0.5);
+ *    sparkline.paint(cr, x, y, width, height, color, 1.0);
+ */
+class Sparkline
+{
+public:
+  Sparkline();
+  virtual ~Sparkline();
+
+  /** Adds a sample. value is clamped to [0, 1]. */
+  void push(float value);
+  /** Gets last sample. */
+  float last();
+
+  void paint(cairo_t *cr, int x, int y, int width, int height, const Color & color, float alpha);
+
+private:
+  void render();
+  void draw_column(int column, float value);
+
+  std::array<float, SPARKLINE_MAX_SAMPLES> m_samples;
+  size_t m_head;  // Position of the next sample
+  size_t m_count; // Number of stored samples
+
+  cairo_surface_t *m_surface;
+  int m_width, m_height;
+  uint32_t m_pixel; // Premultiplied ARGB32 pixel of bars
+};
+
+#endif
@@ -0,0 +1,241 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "stats.h"
+#include "eventloop.h"
+#include "settings.h"
+#include <time.h>
+#include <sstream>
+#include <iostream>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/signalfd.h>
+
+Stats Stats::m_stats;
+
+/** Bucket of histogram: values lower than 4 have their own bucket, 
+ *  bigger values use 4 buckets for each power of two.
+ */
+static int latency_bucket(uint64_t usecs)
+{
+  if(usecs < 4)
+    return usecs;
+  int msb = 63 - __builtin_clzll(usecs);
+  int bucket = (msb - 1) * 4 + ((usecs >> (msb - 2)) & 3);
+  return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+/** Greatest value of bucket.
+ */
+static uint64_t latency_bucket_max(int bucket)
+{
+  if(bucket < 4)
+    return bucket;
+  int msb = bucket / 4 + 1;
+  uint64_t sub = bucket % 4;
+  return ((4 + sub + 1) << (msb - 2)) - 1;
+}
+
+void Latency::record(uint64_t usecs)
+{
+  count++;
+  total_usecs += usecs;
+  if(usecs > max_usecs)
+    max_usecs = usecs;
+  buckets[latency_bucket(usecs)]++;
+}
+
+uint64_t Latency::percentile(double p) const
+{
+  if(count == 0)
+    return 0;
+  uint64_t rank = p * count;
+  if(rank >= count)
+    rank = count - 1;
+  uint64_t n = 0;
+  for(int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+    n += buckets[bucket];
+    if(n > rank) {
+      uint64_t value = latency_bucket_max(bucket);
+      return value < max_usecs ? value : max_usecs;
+    }
+  }
+  return max_usecs;
+}
+
+Stats::Stats()
+{
+  m_server_fd = m_signal_fd = -1;
+}
+
+Stats::~Stats()
+{
+  if(m_server_fd >= 0) {
+    close(m_server_fd);
+    unlink(m_server_path.c_str());
+  }
+  if(m_signal_fd >= 0)
+    close(m_signal_fd);
+}
+
+Stats *Stats::get_stats()
+{
+  return &m_stats;
+}
+
+Latency *Stats::latency(const std::string & name)
+{
+  // std::map doesn't move its nodes, pointers to them are stable
+  auto item = m_latencies.find(name);
+  if(item == m_latencies.end())
+    item = m_latencies.insert({name, Latency{}}).first;
+  return &(item->second);
+}
+
+uint64_t *Stats::counter(const std::string & name)
+{
+  auto item = m_counters.find(name);
+  if(item == m_counters.end())
+    item = m_counters.insert({name, 0}).first;
+  return &(item->second);
+}
+
+int64_t *Stats::gauge(const std::string & name)
+{
+  auto item = m_gauges.find(name);
+  if(item == m_gauges.end())
+    item = m_gauges.insert({name, 0}).first;
+  return &(item->second);
+}
+
+void Stats::dump(std::ostream & out)
+{
+  for(auto & item : m_counters)
+    out << item.first << " " << item.second << std::endl;
+  for(auto & item : m_gauges)
+    out << item.first << " " << item.second << std::endl;
+  for(auto & item : m_latencies) {
+    const Latency & latency = item.second;
+    uint64_t avg = latency.count > 0 ? latency.total_usecs / latency.count : 0;
+    out << item.first << " count " << latency.count
+      << " avg " << avg << "us"
+      << " p50 " << latency.percentile(0.5) << "us"
+      << " p99 " << latency.percentile(0.99) << "us"
+      << " max " << latency.max_usecs << "us" << std::endl;
+  }
+}
+
+void Stats::dump_openmetrics(std::ostream & out)
+{
+  for(auto & item : m_counters) {
+    out << "# TYPE yatbfw_" << item.first << " counter\n";
+    out << "yatbfw_" << item.first << "_total " << item.second << "\n";
+  }
+  for(auto & item : m_gauges) {
+    out << "# TYPE yatbfw_" << item.first << " gauge\n";
+    out << "yatbfw_" << item.first << " " << item.second << "\n";
+  }
+  for(auto & item : m_latencies) {
+    const Latency & latency = item.second;
+    std::string name = "yatbfw_" + item.first + "_seconds";
+    out << "# TYPE " << name << " summary\n";
+    out << "# UNIT " << name << " seconds\n";
+    out << name << "{quantile=\"0.5\"} " << latency.percentile(0.5) / 1e6 << "\n";
+    out << name << "{quantile=\"0.99\"} " << latency.percentile(0.99) / 1e6 << "\n";
+    out << name << "_sum " << latency.total_usecs / 1e6 << "\n";
+    out << name << "_count " << latency.count << "\n";
+  }
+  out << "# EOF\n";
+}
+
+void Stats::start_server()
+{
+  // SIGUSR1 writes stats to stderr
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGUSR1);
+  if(sigprocmask(SIG_BLOCK, &mask, nullptr) == 0)
+    m_signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if(m_signal_fd >= 0) {
+    EventLoop::add_fd(m_signal_fd, POLLIN, [this](short revents) {
+      struct signalfd_siginfo info;
+      while(read(m_signal_fd, &info, sizeof(info)) == sizeof(info))
+        dump(std::cerr);
+    });
+  }
+
+  std::string runtime_dir = Settings::get_env("XDG_RUNTIME_DIR");
+  if(runtime_dir.empty())
+    return;
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  m_server_path = runtime_dir + "/yatbfw.sock";
+  if(m_server_path.size() >= sizeof(address.sun_path))
+    return;
+  strcpy(address.sun_path, m_server_path.c_str());
+
+  m_server_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if(m_server_fd < 0)
+    return;
+  int ok = bind(m_server_fd, (struct sockaddr*)&address, sizeof(address));
+  if(ok < 0 && errno == EADDRINUSE) {
+    // Remove the socket if no panel is using it
+    int client = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(client >= 0 && connect(client, (struct sockaddr*)&address, sizeof(address)) < 0 && errno == ECONNREFUSED) {
+      unlink(m_server_path.c_str());
+      ok = bind(m_server_fd, (struct sockaddr*)&address, sizeof(address));
+    } else
+      errno = EADDRINUSE;
+    if(client >= 0)
+      close(client);
+  }
+  if(ok < 0 || listen(m_server_fd, 4) < 0) {
+    debug_error << m_server_path << " cannot be used: " << strerror(errno) << std::endl;
+    close(m_server_fd);
+    m_server_fd = -1;
+    return;
+  }
+
+  // Each client gets the stats and the connection is closed
+  EventLoop::add_fd(m_server_fd, POLLIN, [this](short revents) {
+    int client;
+    while((client = accept4(m_server_fd, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+      std::ostringstream out;
+      dump_openmetrics(out);
+      std::string text = out.str();
+      size_t sent = 0;
+      while(sent < text.size()) {
+        ssize_t n = send(client, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if(n <= 0)
+          break;
+        sent += n;
+      }
+      close(client);
+    }
+  });
+}
+
+uint64_t Stats::now_usecs()
+{
+  struct timespec time_aux;
+  clock_gettime(CLOCK_MONOTONIC, &time_aux);
+  return (uint64_t)time_aux.tv_sec * 1000000 + time_aux.tv_nsec / 1000;
+}
@@ -0,0 +1,117 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <string>
+#include <map>
+#include <ostream>
+#include <stdint.h>
+
+#define LATENCY_BUCKETS 128
+
+/*! \struct Latency
+ *  \brief Number of samples, total and maximum of a time in microseconds.
+ *
+ *  Samples are also counted in a histogram to get percentiles. Each power
+ *  of two is divided in 4 buckets, so percentiles have an error lower than 25%.
+ */
+struct Latency
+{
+  uint64_t count;
+  uint64_t total_usecs;
+  uint64_t max_usecs;
+  uint32_t buckets[LATENCY_BUCKETS];
+
+  void record(uint64_t usecs);
+  /** Approximated percentile. p is from 0.0 to 1.0.
+   */
+  uint64_t percentile(double p) const;
+};
+
+/*! \class Stats
+ *  \brief Counters and latencies of the panel.
+ *
+ *  Example:
+ *    static Latency *launch = Stats::get_stats()->latency("launch");
+ *    uint64_t start = Stats::now_usecs();
+ *    ...
+ *    launch->record(Stats::now_usecs() - start);
+ *
+ *  Stats can be read while panel runs from the socket 
+ *  $XDG_RUNTIME_DIR/yatbfw.sock (example: socat - UNIX-CONNECT:$XDG_RUNTIME_DIR/yatbfw.sock)
+ *  or sending SIGUSR1 to the panel, which writes them to stderr.
+ */
+class Stats
+{
+public:
+  static Stats *get_stats();
+  Stats();
+  ~Stats();
+
+  /** Gets the latency called name. The pointer is valid until the end of program. */
+  Latency *latency(const std::string & name);
+  /** Gets the counter called name. The pointer is valid until the end of program. */
+  uint64_t *counter(const std::string & name);
+  /** Gets the gauge called name. Gauges are values that can go up and down. 
+   *  The pointer is valid until the end of program. */
+  int64_t *gauge(const std::string & name);
+
+  /** Writes all counters and latencies to out. */
+  void dump(std::ostream & out);
+  /** Writes all counters and latencies to out in OpenMetrics text format. */
+  void dump_openmetrics(std::ostream & out);
+
+  /** Listens on $XDG_RUNTIME_DIR/yatbfw.sock and SIGUSR1.
+   */
+  void start_server();
+
+  /** Monotonic time in microseconds. */
+  static uint64_t now_usecs();
+
+private:
+  static Stats m_stats; // Unique instance of stats
+  std::map<std::string, Latency> m_latencies;
+  std::map<std::string, uint64_t> m_counters;
+  std::map<std::string, int64_t> m_gauges;
+  int m_server_fd, m_signal_fd;
+  std::string m_server_path;
+};
+
+/*! \class ScopedLatency
+ *  \brief Records the time from its creation to the end of its scope.
+ *
+ *  Example:
+ *    static Latency *paint = Stats::get_stats()->latency("paint");
+ *    {
+ *      ScopedLatency timer(paint);
+ *      ...
+ *    }
+ */
+class ScopedLatency
+{
+public:
+  ScopedLatency(Latency *latency) : m_latency(latency), m_start(Stats::now_usecs()) {}
+  ~ScopedLatency() { m_latency->record(Stats::now_usecs() - m_start); }
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+  Latency *m_latency;
+  uint64_t m_start;
+};
+
+#endif
@@ -0,0 +1,84 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "style.h"
+
+static std::shared_ptr<const Style> current_style;
+
+std::shared_ptr<const Style> Style::get_style()
+{
+  std::shared_ptr<const Style> style = std::atomic_load(&current_style);
+  if(!style) {
+    style = std::make_shared<const Style>(Settings::get_settings());
+    std::atomic_store(&current_style, style);
+  }
+  return style;
+}
+
+void Style::set_style(std::shared_ptr<const Style> style)
+{
+  std::atomic_store(&current_style, style);
+}
+
+static cairo_scaled_font_t *create_font(const std::string & family, cairo_font_weight_t weight, double size)
+{
+  cairo_font_face_t *face = cairo_toy_font_face_create(family.c_str(), CAIRO_FONT_SLANT_NORMAL, weight);
+  cairo_matrix_t font_matrix, ctm;
+  cairo_matrix_init_scale(&font_matrix, size, size);
+  cairo_matrix_init_identity(&ctm);
+  cairo_font_options_t *options = cairo_font_options_create();
+  // Scaled font keeps a reference to face
+  cairo_scaled_font_t *font = cairo_scaled_font_create(face, &font_matrix, &ctm, options);
+  cairo_font_options_destroy(options);
+  cairo_font_face_destroy(face);
+  if(cairo_scaled_font_status(font) != CAIRO_STATUS_SUCCESS)
+    debug_error << "Font " << family << " cannot be loaded: " << cairo_status_to_string(cairo_scaled_font_status(font)) << std::endl;
+  return font;
+}
+
+static cairo_pattern_t *create_pattern(const Color & color, double alpha)
+{
+  return cairo_pattern_create_rgba(color.red, color.green, color.blue, alpha);
+}
+
+Style::Style(Settings *settings)
+{
+  m_color = settings->color();
+  m_background_color = settings->background_color();
+  m_panel_size = settings->panel_size();
+
+  m_font = create_font(settings->font(), CAIRO_FONT_WEIGHT_NORMAL, settings->font_size());
+  m_label_font = create_font(settings->font(), CAIRO_FONT_WEIGHT_BOLD, settings->font_size() * 0.6);
+  cairo_scaled_font_extents(m_font, &m_font_extents);
+
+  Color inverse = {1.0f - m_color.red, 1.0f - m_color.green, 1.0f - m_color.blue};
+  m_foreground = create_pattern(m_color, 1.0);
+  m_background = create_pattern(m_background_color, 1.0);
+  m_hover = create_pattern(m_color, 0.3);
+  m_pressed = create_pattern(inverse, 1.0);
+  m_selected = create_pattern(inverse, 0.3);
+  m_tooltip_background = create_pattern(m_background_color, 0.5);
+  m_tooltip_border = create_pattern(m_color, 0.5);
+  m_label_background = create_pattern(m_background_color, 0.8);
+}
+
+Style::~Style()
+{
+  cairo_scaled_font_destroy(m_font);
+  cairo_scaled_font_destroy(m_label_font);
+  for(cairo_pattern_t *pattern : {m_foreground, m_background, m_hover, m_pressed, m_selected, m_tooltip_background, m_tooltip_border, m_label_background})
+    cairo_pattern_destroy(pattern);
+}
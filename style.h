@@ -0,0 +1,79 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __STYLE_H__
+#define __STYLE_H__
+
+#include <cairo/cairo.h>
+#include <memory>
+#include "settings.h"
+
+/*! \class Style
+ *  \brief Colors and fonts of settings compiled for cairo.
+ *
+ *  Fonts are resolved when the style is built, not each time text is 
+ *  painted, and colors of item states are solid patterns.
+ *  Styles are immutable. When settings are loaded, a new style replaces 
+ *  the current one; code painting with the old style keeps it alive 
+ *  until it finishes.
+ *
+ *  Example:
+ *    std::shared_ptr<const Style> style = Style::get_style();
+ *    cairo_set_scaled_font(cr, style->font());
+ *    cairo_set_source(cr, style->foreground());
+ */
+class Style
+{
+public:
+  /** Current style. If settings haven't been loaded, it is built from default settings.
+   */
+  static std::shared_ptr<const Style> get_style();
+  static void set_style(std::shared_ptr<const Style> style);
+
+  Style(Settings *settings);
+  ~Style();
+  Style(const Style&) = delete;
+  Style& operator=(const Style&) = delete;
+
+  const Color & color() const { return m_color; }
+  const Color & background_color() const { return m_background_color; }
+  cairo_scaled_font_t *font() const { return m_font; }
+  /** Bold font used by small labels, as number of windows of a group. */
+  cairo_scaled_font_t *label_font() const { return m_label_font; }
+  const cairo_font_extents_t & font_extents() const { return m_font_extents; }
+  int panel_size() const { return m_panel_size; }
+
+  // Patterns of items
+  cairo_pattern_t *foreground() const { return m_foreground; }
+  cairo_pattern_t *background() const { return m_background; }
+  /** Painted over background when pointer is over the item. */
+  cairo_pattern_t *hover() const { return m_hover; }
+  cairo_pattern_t *pressed() const { return m_pressed; }
+  /** Painted over selected items. */
+  cairo_pattern_t *selected() const { return m_selected; }
+  cairo_pattern_t *tooltip_background() const { return m_tooltip_background; }
+  cairo_pattern_t *tooltip_border() const { return m_tooltip_border; }
+  cairo_pattern_t *label_background() const { return m_label_background; }
+
+private:
+  Color m_color, m_background_color;
+  cairo_scaled_font_t *m_font, *m_label_font;
+  cairo_font_extents_t m_font_extents;
+  int m_panel_size;
+  cairo_pattern_t *m_foreground, *m_background, *m_hover, *m_pressed, *m_selected;
+  cairo_pattern_t *m_tooltip_background, *m_tooltip_border, *m_label_background;
+};
+
+#endif
@@ -0,0 +1,241 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "sysfswatch.h"
+#include "eventloop.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/inotify.h>
+
+// If attribute cannot be read (device has been removed), it is opened
+// again each RETRY_INTERVAL milliseconds
+#define RETRY_INTERVAL 5000
+
+static bool read_attribute(int fd, std::string & value)
+{
+  char buffer[256];
+  ssize_t size = pread(fd, buffer, sizeof(buffer) - 1, 0);
+  if(size < 0)
+    return false;
+  // Attributes end with a new line
+  while(size > 0 && (buffer[size - 1] == '\n' || buffer[size - 1] == ' '))
+    size--;
+  value.assign(buffer, size);
+  return true;
+}
+
+SysfsWatch::SysfsWatch(
+   const std::string & path,
+   const std::string & max_path,
+   double scale,
+   int decimals,
+   int interval,
+   const std::string & text,
+   const std::string & tooltip,
+   const std::vector<SysfsThreshold> & thresholds
+) : ButtonRunCommand()
+{
+  m_path = path;
+  m_scale = scale;
+  m_decimals = decimals < 0 ? 0 : decimals;
+  m_text = text;
+  m_tooltip = tooltip;
+  m_thresholds = thresholds;
+  m_is_number = false;
+  m_number = 0.0;
+  m_max = 0.0;
+  m_interval = interval;
+  m_fd = m_inotify_fd = -1;
+
+  if(!max_path.empty()) {
+    int fd = open(max_path.c_str(), O_RDONLY | O_CLOEXEC);
+    std::string max;
+    if(fd >= 0 && read_attribute(fd, max))
+      m_max = strtod(max.c_str(), nullptr);
+    if(fd >= 0)
+      close(fd);
+  }
+
+  if(!open_attribute())
+    set_unavailable();
+  update();
+  if(interval > 0)
+    set_timeout(interval);
+}
+
+SysfsWatch::~SysfsWatch()
+{
+  close_attribute();
+}
+
+/** Opens the attribute, reads it and watches its changes.
+ */
+bool SysfsWatch::open_attribute()
+{
+  m_fd = open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(m_fd < 0)
+    return false;
+
+  // sysfs attributes which support notifications wake up poll with POLLPRI.
+  // Attribute must be read before waiting.
+  read_value();
+  if(m_fd < 0)
+    return false;
+  EventLoop::add_fd(m_fd, POLLPRI, [this](short revents) {
+    // sysfs_notify also sends POLLERR. Removed attributes are detected
+    // when they cannot be read.
+    if(revents & (POLLHUP | POLLNVAL))
+      set_unavailable();
+    else if(!read_value())
+      return;
+    update();
+  });
+
+  // Changes made by other processes are reported by inotify
+  m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(m_inotify_fd >= 0 && inotify_add_watch(m_inotify_fd, m_path.c_str(), IN_MODIFY) >= 0) {
+    EventLoop::add_fd(m_inotify_fd, POLLIN, [this](short revents) {
+      char buffer[sizeof(struct inotify_event) + 256];
+      while(read(m_inotify_fd, buffer, sizeof(buffer)) > 0);
+      if(read_value())
+        update();
+    });
+  } else if(m_inotify_fd >= 0) {
+    close(m_inotify_fd);
+    m_inotify_fd = -1;
+  }
+  return true;
+}
+
+void SysfsWatch::close_attribute()
+{
+  if(m_fd >= 0) {
+    EventLoop::remove_fd(m_fd);
+    close(m_fd);
+    m_fd = -1;
+  }
+  if(m_inotify_fd >= 0) {
+    EventLoop::remove_fd(m_inotify_fd);
+    close(m_inotify_fd);
+    m_inotify_fd = -1;
+  }
+}
+
+/** Stops watching an attribute which cannot be read. Otherwise poll would
+ *  return at once forever. It is opened again from timeout().
+ */
+void SysfsWatch::set_unavailable()
+{
+  debug_error << m_path << " is unavailable: " << strerror(errno) << std::endl;
+  close_attribute();
+  m_raw_value.clear();
+  m_value = "unavailable";
+  m_is_number = false;
+  if(m_interval <= 0)
+    set_timeout(RETRY_INTERVAL);
+}
+
+/** Reads the attribute. Returns true if it has changed.
+ *  If it cannot be read, item is set as unavailable.
+ */
+bool SysfsWatch::read_value()
+{
+  std::string raw_value;
+  if(m_fd < 0)
+    return false;
+  if(!read_attribute(m_fd, raw_value)) {
+    set_unavailable();
+    return true;
+  }
+  if(raw_value == m_raw_value)
+    return false;
+  m_raw_value = raw_value;
+
+  char *end = nullptr;
+  double number = strtod(m_raw_value.c_str(), &end);
+  m_is_number = !m_raw_value.empty() && end != nullptr && *end == '\0';
+  if(m_is_number) {
+    m_number = number * m_scale;
+    if(m_max > 0.0)
+      m_number = 100.0 * number / m_max;
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", m_decimals, m_number);
+    m_value = buffer;
+  } else
+    m_value = m_raw_value;
+  debug << m_path << ": " << m_value << std::endl;
+  return true;
+}
+
+std::string SysfsWatch::format(const std::string & text)
+{
+  std::string out = text;
+  size_t pos = 0;
+  while((pos = out.find("%v", pos)) != std::string::npos) {
+    out.replace(pos, 2, m_value);
+    pos += m_value.size();
+  }
+  return out;
+}
+
+void SysfsWatch::update()
+{
+  const SysfsThreshold *threshold = nullptr;
+  for(const SysfsThreshold & item : m_thresholds) {
+    if(!item.equals.empty()) {
+      if(item.equals == m_raw_value) {
+        threshold = &item;
+        break;
+      }
+    } else if(m_is_number && m_number >= item.min && (threshold == nullptr || item.min > threshold->min))
+      threshold = &item;
+  }
+
+  std::string text = m_text;
+  if(threshold != nullptr) {
+    set_icon(threshold->icon);
+    if(!threshold->text.empty())
+      text = threshold->text;
+  }
+  set_text(format(text));
+  if(send_repaint)
+    send_repaint();
+}
+
+void SysfsWatch::timeout()
+{
+  if(m_fd < 0) {
+    if(!open_attribute())
+      return;
+    debug << m_path << " is available again" << std::endl;
+    if(m_interval <= 0)
+      set_timeout(-1);
+    update();
+  } else if(read_value())
+    update();
+}
+
+void SysfsWatch::mouse_enter()
+{
+  if(m_tooltip.empty())
+    show_tooltip(m_path + ": " + m_value);
+  else
+    show_tooltip(format(m_tooltip));
+}
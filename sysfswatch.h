@@ -0,0 +1,106 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __SYSFSWATCH_H__
+#define __SYSFSWATCH_H__
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "buttonruncommand.h"
+
+/*! \struct SysfsThreshold
+ *  \brief Icon and text for a range of values.
+ *
+ *  If equals isn't empty, it is used when the value read is equals.
+ *  Otherwise it is used when value >= min and there isn't another
+ *  threshold with a greater min.
+ */
+struct SysfsThreshold
+{
+  double min;
+  std::string equals;
+  std::string icon;
+  std::string text; // If it is empty, the item text is used
+};
+
+/*! \class SysfsWatch
+ *  \brief Shows the value of a sysfs or procfs attribute.
+ *
+ *  The attribute file is kept open. Changes are read when kernel sends
+ *  a POLLPRI notification (sysfs_notify) or inotify reports a change.
+ *  As not all attributes send notifications, file can also be read each
+ *  interval milliseconds. Reads are aligned to the interval.
+ *  If the attribute cannot be read (device has been removed), "%v" is
+ *  "unavailable" and the attribute is opened again periodically.
+ *  The value is mapped to icons and text using thresholds, like the 
+ *  battery levels.
+ *  "%v" in texts is changed by the value.
+ *
+ *  As ButtonRunCommand child a command can be run when
+ *  item is clicked.
+ */
+class SysfsWatch : public ButtonRunCommand
+{
+public:
+  /** \param path attribute to read.
+   *  \param max_path if it isn't empty, value is shown as percentage of this attribute.
+   *  \param scale value is multiplied by scale (example: 0.001 for millidegrees).
+   *  \param decimals number of decimals of value.
+   *  \param interval milliseconds between reads. If 0, only notifications are used.
+   *  \param text text of item.
+   *  \param tooltip tooltip text.
+   *  \param thresholds icons and texts for values.
+   */
+  SysfsWatch(
+     const std::string & path,
+     const std::string & max_path,
+     double scale,
+     int decimals,
+     int interval,
+     const std::string & text,
+     const std::string & tooltip,
+     const std::vector<SysfsThreshold> & thresholds
+  );
+  virtual ~SysfsWatch();
+
+  virtual void timeout() override;
+  virtual void mouse_enter() override;
+
+  std::function<void()> send_repaint;
+
+private:
+  bool open_attribute();
+  void close_attribute();
+  void set_unavailable();
+  bool read_value();
+  void update();
+  std::string format(const std::string & text);
+
+  std::string m_path;
+  int m_fd, m_inotify_fd;
+  int m_interval;
+  double m_max, m_scale;
+  int m_decimals;
+  std::string m_text, m_tooltip;
+  std::vector<SysfsThreshold> m_thresholds;
+
+  std::string m_raw_value;
+  std::string m_value; // Formatted value
+  bool m_is_number;
+  double m_number;
+};
+
+#endif
@@ -0,0 +1,167 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "sysmonitor.h"
+#include "stats.h"
+#include "style.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+/** Parses next unsigned number in [p, end). Returns position after the number
+ * or nullptr if there isn't a number.
+ */
+static const char *parse_number(const char *p, const char *end, uint64_t & value)
+{
+  while(p < end && (*p < '0' || *p > '9')) {
+    if(*p == '\n')
+      return nullptr;
+    p++;
+  }
+  if(p >= end)
+    return nullptr;
+  value = 0;
+  while(p < end && *p >= '0' && *p <= '9')
+    value = value * 10 + (*(p++) - '0');
+  return p;
+}
+
+/** Finds the value of key in meminfo text. Returns false if key isn't found.
+ */
+static bool parse_meminfo_key(const char *p, const char *end, const char *key, uint64_t & value)
+{
+  size_t key_size = strlen(key);
+  while(p < end) {
+    if((size_t)(end - p) > key_size && memcmp(p, key, key_size) == 0 && p[key_size] == ':')
+      return parse_number(p + key_size + 1, end, value) != nullptr;
+    p = (const char*)memchr(p, '\n', end - p);
+    if(p == nullptr)
+      break;
+    p++;
+  }
+  return false;
+}
+
+static int open_proc_file(const char *path)
+{
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if(fd < 0)
+    debug_error << path << " cannot be opened" << std::endl;
+  return fd;
+}
+
+SysMonitor::SysMonitor(int interval, int width) : ButtonRunCommand()
+{
+  m_stat_fd = open_proc_file("/proc/stat");
+  m_meminfo_fd = open_proc_file("/proc/meminfo");
+  m_last_busy = m_last_total = 0;
+  m_memory_total = m_memory_available = 0;
+  m_cpu_usage = m_memory_usage = 0.0;
+  m_item_width = width;
+
+  sample();
+  set_timeout(interval > 0 ? interval : 1000);
+}
+
+SysMonitor::~SysMonitor()
+{
+  if(m_stat_fd >= 0)
+    close(m_stat_fd);
+  if(m_meminfo_fd >= 0)
+    close(m_meminfo_fd);
+}
+
+bool SysMonitor::sample()
+{
+  static Latency *sample_latency = Stats::get_stats()->latency("sysmonitor_sample");
+  uint64_t start = Stats::now_usecs();
+
+  if(m_stat_fd < 0 || m_meminfo_fd < 0)
+    return false;
+
+  // First line of /proc/stat: "cpu  user nice system idle iowait irq softirq steal guest guest_nice"
+  ssize_t size = pread(m_stat_fd, m_buffer, sizeof(m_buffer), 0);
+  if(size <= 0)
+    return false;
+  const char *p = m_buffer, *end = m_buffer + size;
+  uint64_t values[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  for(int n = 0; n < 8 && p != nullptr; n++)
+    p = parse_number(p, end, values[n]);
+  // guest times are included in user times
+  uint64_t total = 0;
+  for(int n = 0; n < 8; n++)
+    total += values[n];
+  uint64_t busy = total - values[3] - values[4]; // idle and iowait
+  if(total > m_last_total && m_last_total > 0)
+    m_cpu_usage = (float)(busy - m_last_busy) / (float)(total - m_last_total);
+  m_last_busy = busy;
+  m_last_total = total;
+
+  // MemTotal and MemAvailable are in the first lines of /proc/meminfo
+  size = pread(m_meminfo_fd, m_buffer, sizeof(m_buffer), 0);
+  if(size <= 0)
+    return false;
+  end = m_buffer + size;
+  if(parse_meminfo_key(m_buffer, end, "MemTotal", m_memory_total)
+      && parse_meminfo_key(m_buffer, end, "MemAvailable", m_memory_available)
+      && m_memory_total > 0)
+    m_memory_usage = 1.0 - (float)m_memory_available / (float)m_memory_total;
+
+  m_cpu_sparkline.push(m_cpu_usage);
+  m_memory_sparkline.push(m_memory_usage);
+
+  sample_latency->record(Stats::now_usecs() - start);
+  return true;
+}
+
+float SysMonitor::cpu_usage()
+{
+  return m_cpu_usage;
+}
+
+float SysMonitor::memory_usage()
+{
+  return m_memory_usage;
+}
+
+void SysMonitor::timeout()
+{
+  if(sample() && send_repaint)
+    send_repaint();
+}
+
+void SysMonitor::mouse_enter()
+{
+  std::string text = "CPU: " + std::to_string((int)(m_cpu_usage * 100.0 + 0.5)) + "%\n"
+    + "Memory: " + std::to_string((m_memory_total - m_memory_available) / 1024)
+    + " / " + std::to_string(m_memory_total / 1024) + " MiB";
+  show_tooltip(text);
+}
+
+void SysMonitor::update_size(cairo_t *cr)
+{
+  m_width = m_item_width;
+}
+
+void SysMonitor::paint(cairo_t *cr)
+{
+  std::shared_ptr<const Style> style = Style::get_style();
+  const Color & color = style->color();
+  int margin = 2;
+  int width = m_width - 2 * margin, height = m_height - 2 * margin;
+  m_memory_sparkline.paint(cr, m_x + margin, m_y + margin, width, height, color, 0.25);
+  m_cpu_sparkline.paint(cr, m_x + margin, m_y + margin, width, height, color, 0.8);
+}
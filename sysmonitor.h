@@ -0,0 +1,71 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __SYSMONITOR_H__
+#define __SYSMONITOR_H__
+
+#include <string>
+#include <functional>
+#include <stdint.h>
+#include "buttonruncommand.h"
+#include "sparkline.h"
+
+
+/*! \class SysMonitor
+ *  \brief CPU and memory usage item to add to panel.
+ *
+ *  /proc/stat and /proc/meminfo are kept open and they are read with pread
+ *  into fixed buffers. Parsing doesn't allocate memory. Usage is shown in
+ *  two sparklines: CPU usage as bars and memory usage as a light area.
+ *
+ *  As ButtonRunCommand child a command can be run when
+ *  item is clicked.
+ */
+class SysMonitor : public ButtonRunCommand
+{
+public:
+  /** \param interval milliseconds between samples.
+   *  \param width width of the item. 
+   */
+  SysMonitor(int interval, int width);
+  virtual ~SysMonitor();
+
+  /** Reads CPU and memory usage and adds them to sparklines.
+   * Returns false if /proc files cannot be read.
+   */
+  bool sample();
+  /** CPU usage between last two samples, in [0, 1]. */
+  float cpu_usage();
+  /** Used memory, in [0, 1]. */
+  float memory_usage();
+
+  virtual void timeout() override;
+  virtual void mouse_enter() override;
+  virtual void paint(cairo_t *cr) override;
+  virtual void update_size(cairo_t *cr) override;
+
+  std::function<void()> send_repaint;
+
+private:
+  int m_stat_fd, m_meminfo_fd;
+  char m_buffer[512];
+  uint64_t m_last_busy, m_last_total;
+  uint64_t m_memory_total, m_memory_available; // kB
+  float m_cpu_usage, m_memory_usage;
+  int m_item_width;
+  Sparkline m_cpu_sparkline, m_memory_sparkline;
+};
+
+#endif
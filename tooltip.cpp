@@ -16,7 +16,9 @@
 #include "debug.h"
 #include "tooltip.h"
 #include "settings.h"
+#include "style.h"
 #include "utils.h"
+#include "trace.h"
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -58,7 +60,8 @@ void ToolTip::init(compositor_t *compositor, display_t *display, xdg_wm_base_t *
 
 void ToolTip::show(const std::string & text, int offset)
 {
-  if(static_tooltip)
+  // Tooltips of headless panels (see Panel::replay) aren't shown
+  if(static_tooltip && static_tooltip->m_compositor)
     static_tooltip->show_tooltip(text, offset);
 }
 
@@ -70,6 +73,7 @@ void ToolTip::hide()
 
 ToolTip::ToolTip()
 {
+  m_compositor = nullptr;
   if(static_tooltip == nullptr)
     static_tooltip = this;
 }
@@ -102,6 +106,7 @@ void ToolTip::hide_tooltip()
 
 void ToolTip::show_tooltip(const std::string & text, int offset)
 {
+  TRACE_SCOPE("ToolTip::show_tooltip");
   debug << "Tooltip offset: " << offset << std::endl;
   if(offset < 1) offset = 1; // xdg_positioner fails if offset is 0
 
@@ -172,7 +177,10 @@ void ToolTip::create_wayland_surface(int offset)
   m_layer_shell_surface->get_popup(m_xdg_popup);
 
   m_surface.commit();
-  m_display->roundtrip();
+  {
+    TRACE_SCOPE("wl_display_roundtrip");
+    m_display->roundtrip();
+  }
 
   // New cairo surface
   if(!m_surface || !m_shared_mem)
@@ -195,15 +203,14 @@ void ToolTip::find_size_for_text(const std::string & text)
   cairo_t *cr = cairo_create(m_cairo_surface);
   
   // Get lines of text
-  std::vector<std::string> lines = get_lines(text);
+  std::pmr::vector<const char *> lines = get_lines(text);
 
-  cairo_select_font_face(cr, Settings::get_settings()->font().c_str(), CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-  cairo_set_font_size(cr, Settings::get_settings()->font_size());
+  cairo_set_scaled_font(cr, Style::get_style()->font());
   m_width = 0; 
   m_height = tooltip_margin/2;
-  for(std::string line : lines) {
+  for(const char *line : lines) {
     cairo_text_extents_t extents;
-    cairo_text_extents(cr, line.c_str(), &extents);
+    cairo_text_extents(cr, line, &extents);
     if(m_width < extents.width)
       m_width = extents.width + tooltip_margin;
     m_height += extents.height + tooltip_margin/2.0;
@@ -215,34 +222,31 @@ void ToolTip::find_size_for_text(const std::string & text)
 
 void ToolTip::draw_text(const std::string & text)
 {
-  std::vector<std::string> lines = get_lines(text);
+  std::pmr::vector<const char *> lines = get_lines(text);
 
   cairo_t *cr = cairo_create(m_cairo_surface);
 
-  Color color = Settings::get_settings()->color();
-  Color background_color = Settings::get_settings()->background_color();
-  cairo_set_source_rgba (cr, background_color.red, background_color.green, background_color.blue, 0.5);
+  std::shared_ptr<const Style> style = Style::get_style();
+  cairo_set_source(cr, style->tooltip_background());
   cairo_rectangle (cr, 0, 0, m_width, m_height);
   cairo_fill(cr);
-  cairo_set_source_rgba (cr, color.red, color.green, color.blue, 0.5);
+  cairo_set_source(cr, style->tooltip_border());
   cairo_rectangle (cr, 0, 0, m_width, m_height);
   cairo_stroke(cr);
 
-  cairo_set_source_rgba (cr, color.red, color.green, color.blue, 1.0);
   cairo_save(cr);
   cairo_rectangle(cr, 0, 0, m_width, m_height);
   cairo_clip(cr);
-  cairo_set_source_rgba (cr, color.red, color.green, color.blue, 1.0);
-  cairo_select_font_face(cr, Settings::get_settings()->font().c_str(), CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-  cairo_set_font_size(cr, Settings::get_settings()->font_size());
+  cairo_set_source(cr, style->foreground());
+  cairo_set_scaled_font(cr, style->font());
 
   const int sep = tooltip_margin/2;
   int y = sep;
-  for(std::string line : lines) {
+  for(const char *line : lines) {
     cairo_text_extents_t extents;
-    cairo_text_extents(cr, line.c_str(), &extents);
+    cairo_text_extents(cr, line, &extents);
     cairo_move_to(cr, tooltip_margin/2.0 + (m_width - tooltip_margin - extents.width)/2, y + extents.height);
-    cairo_show_text(cr, line.c_str());
+    cairo_show_text(cr, line);
     y += extents.height + sep;
   }
   cairo_restore(cr);
@@ -16,100 +16,46 @@
 #include "debug.h"
 #include "toplevelbutton.h"
 #include <iostream>
-#include <fstream>
 #include <filesystem>
-#include <regex>
+#include "inifile.h"
 #include <linux/input-event-codes.h>
 #include "settings.h"
+#include "utils.h"
+#include "eventrecorder.h"
 #include <unordered_map>
 
 static std::string suggested_icon_for_id(std::string id);
-static std::unordered_map<std::string, std::string> init_icon_exec_map();
-static std::unordered_map<std::string, std::string> icon_exec_map = init_icon_exec_map();
+static std::string icon_for_app_id(std::string id);
 
+// Icons found for application ids
+static std::unordered_map<std::string, std::string> app_id_icons;
 
-ToplevelButton::ToplevelButton(wayland::zwlr_foreign_toplevel_handle_v1_t toplevel_handle, wayland::seat_t seat, std::vector<std::shared_ptr<ToplevelButton> > *toplevels) : Button()
+
+ToplevelButton::ToplevelButton(wayland::zwlr_foreign_toplevel_handle_v1_t toplevel_handle, wayland::seat_t seat, ToplevelList *toplevels) : Button()
 { 
   m_toplevels = toplevels;
+  m_id = intern_string(std::string());
   m_toplevel_handle = toplevel_handle;
   m_seat = seat;
   m_maximized = m_activated = m_minimized = m_fullscreen = false;
+  static uint32_t next_event_id = 0;
+  m_event_id = next_event_id++;
+  if(EventRecorder::recording())
+    EventRecorder::get_recorder()->record("toplevel", m_event_id);
+
+  if(!m_toplevel_handle)
+    return;
 
-  // Listen all window events
+  // Listen all window events.
   m_toplevel_handle.on_title() =[&](std::string title) {
-    m_title = title;
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("title", m_event_id, title);
+    on_title(title);
   };
   m_toplevel_handle.on_app_id() =[&](std::string id) {
-    m_id = id;
-    std::string icon;
-    // Is this icon already loaded?
-    for(auto b : *m_toplevels) {
-      if(b->m_id == m_id && b.get() != this) {
-        icon = b->get_icon();
-        debug << "Icon has been already loaded for id " << id << " icon " << icon << std::endl; 
-        break;
-      }
-    }
-    if(icon.empty()) {
-      icon = suggested_icon_for_id(id);
-    }
-    debug << "\ticon for id: " << id << " icon: >" << icon << "<" << std::endl;
-    if(icon.empty() && id.find(" ") != id.npos) {
-      // Id sometimes has spaces. Change id by fisrt word.
-      id = id.substr(0, id.find(" "));
-    }
-    if(icon.empty()) {
-      // Change id of icon to lower case (icons are saved as lower case files)
-      std::string mod_id = id;
-      for(char &ch : mod_id) {ch = std::tolower(ch);}
-      icon = suggested_icon_for_id(mod_id);
-      debug << "\ticon for id: " << mod_id << " icon: >" << icon << "<" << std::endl;
-    }
-    if(icon.empty()) {
-      // Sometimes id has id.xx.xx format, the first element must be extracted
-      std::string::size_type pos = id.find('.');
-      std::string mod_id;
-      if(pos != std::string::npos)
-        mod_id = id.substr(0, pos);
-      icon = suggested_icon_for_id(mod_id);
-      debug << "\ticon for id: " << mod_id << " icon: >" << icon << "<" << std::endl;
-      if(icon.empty()) {
-        // Sometimes id is in D-BUS format: xx.xx.id, where id is in PascalCase
-        // Change id of icon to lower case (icons are saved as lower case files)
-        for(char &ch : mod_id) {ch = std::tolower(ch);}
-        icon = suggested_icon_for_id(mod_id);
-        debug << "\ticon for id: " << mod_id << " icon: >" << icon << "<" << std::endl;
-      }
-    }
-    if(icon.empty()) {
-      // Sometimes id has xx.xx.id format, the last element must be extracted
-      std::string::size_type pos = id.find_last_of('.');
-      std::string mod_id;
-      if(pos != std::string::npos)
-        mod_id = id.substr(pos + 1);
-      icon = suggested_icon_for_id(mod_id);
-      debug << "\ticon for id: " << mod_id << " icon: >" << icon << "<" << std::endl;
-      if(icon.empty()) {
-        // Sometimes id is in D-BUS format: xx.xx.id, where id is in PascalCase
-        // Change id of icon to lower case (icons are saved as lower case files)
-        for(char &ch : mod_id) {ch = std::tolower(ch);}
-        icon = suggested_icon_for_id(mod_id);
-        debug << "\ticon for id: " << mod_id << " icon: >" << icon << "<" << std::endl;
-      }
-    }
-    if(icon.empty() && icon_exec_map.find(id) != icon_exec_map.end()) {
-      icon = icon_exec_map[id];
-      debug << "\ticon for id: " << id << " icon: >" << icon << "<" << std::endl;
-    }
-    if(icon.empty()) {
-      icon = suggested_icon_for_id(std::string("dialog-question"));
-      debug << "not icon found for id " << id << std::endl;
-    }
-    if(icon.empty())
-      init(icon, id);
-    else
-      init(icon, std::string());
-    repaint_main_interface(true);
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("app_id", m_event_id, id);
+    on_app_id(id);
   };
   m_toplevel_handle.on_output_enter() =[&](wayland::output_t output) {
     m_output = output;
@@ -117,34 +63,203 @@ ToplevelButton::ToplevelButton(wayland::zwlr_foreign_toplevel_handle_v1_t toplev
   m_toplevel_handle.on_output_leave() =[&](wayland::output_t output) {
   };
   m_toplevel_handle.on_state() =[&](wayland::array_t state) {
-    m_state = state;
-    update_states(state);
-    repaint_main_interface(true);
+    States states = static_cast<States>(state);
+    if(EventRecorder::recording()) {
+      std::string text;
+      for(wayland::zwlr_foreign_toplevel_handle_v1_state item : states)
+        text += (text.empty() ? "" : ",") + std::to_string((uint32_t)item);
+      EventRecorder::get_recorder()->record("state", m_event_id, text);
+    }
+    on_state(states);
   };
   m_toplevel_handle.on_done() =[&]() {
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("done", m_event_id);
+    on_done();
   };
   m_toplevel_handle.on_closed() =[&]() {
-    auto iter = std::remove_if(
-        m_toplevels->begin(), m_toplevels->end(), 
-        [this](std::shared_ptr<ToplevelButton> item) {
-          return item.get() == this;
-        }
-    );
-    m_toplevels->erase(iter, m_toplevels->end());
-    repaint_main_interface(false);
+    if(EventRecorder::recording())
+      EventRecorder::get_recorder()->record("closed", m_event_id);
+    on_closed();
   };
 }
 
+// Changes are saved in m_pending and applied when done event is received.
+
+void ToplevelButton::on_title(const std::string & title)
+{
+  m_pending.title = title;
+  m_pending.has_title = true;
+}
+
+void ToplevelButton::on_app_id(const std::string & app_id)
+{
+  m_pending.app_id = app_id;
+  m_pending.has_app_id = true;
+}
+
+void ToplevelButton::on_state(const States & states)
+{
+  m_pending.state = states;
+  m_pending.has_state = true;
+}
+
+void ToplevelButton::on_done()
+{
+  apply_pending();
+}
+
+void ToplevelButton::on_closed()
+{
+  if(closed)
+    closed(this);
+  if(m_toplevels->selected == this)
+    m_toplevels->selected = nullptr;
+  if(!m_id->empty())
+    m_toplevels->pool.put(m_id, take_icon_cache());
+  // Keeps this button alive until the end of this function
+  std::shared_ptr<ToplevelButton> self;
+  if(std::shared_ptr<ToplevelButton> *item = m_toplevels->buttons.get(m_handle))
+    self = *item;
+  m_toplevels->buttons.remove(m_handle);
+  repaint_main_interface(false);
+}
+
+uint32_t ToplevelButton::get_event_id()
+{
+  return m_event_id;
+}
+
+/** Applies changes received since last done event.
+ *  Main interface is repainted once.
+ */
+void ToplevelButton::apply_pending()
+{
+  bool repaint = false;
+  if(m_pending.has_title) {
+    m_title = m_pending.title;
+  }
+  if(m_pending.has_app_id && *m_id != m_pending.app_id) {
+    const std::string *old_id = m_id;
+    m_id = intern_string(m_pending.app_id);
+    // Icon of a closed window of the same application can be reused
+    Button::IconCache cache;
+    if(m_toplevels->pool.take(m_id, cache))
+      set_icon_cache(std::move(cache));
+    else
+      update_icon();
+    if(app_id_changed)
+      app_id_changed(this, *old_id);
+    repaint = true;
+  }
+  // Compositors send the same states again when focus changes
+  if(m_pending.has_state && m_pending.state != m_state) {
+    m_state = std::move(m_pending.state);
+    update_states(m_state);
+    repaint = true;
+  }
+  m_pending = Pending();
+  if(repaint)
+    repaint_main_interface(true);
+}
+
+/** Finds the icon for an application id. Results are cached, 
+ *  so windows of the same application don't search again.
+ */
+static std::string icon_for_app_id(std::string id)
+{
+  auto cached = app_id_icons.find(id);
+  if(cached != app_id_icons.end()) {
+    debug << "Icon has been already loaded for id " << id << " icon " << cached->second << std::endl; 
+    return cached->second;
+  }
+  const std::string app_id = id;
+  std::string icon = suggested_icon_for_id(id);
+  debug << "\ticon for id: " << id << " icon: >" << icon << "<" << std::endl;
+  if(icon.empty() && id.find(" ") != id.npos) {
+    // Id sometimes has spaces. Change id by fisrt word.
+    id = id.substr(0, id.find(" "));
+  }
+  if(icon.empty()) {
+    // Change id of icon to lower case (icons are saved as lower case files)
+    std::string mod_id = id;
+    for(char &ch : mod_id) {ch = std::tolower(ch);}
+    icon = suggested_icon_for_id(mod_id);
+    debug << "\ticon for id: " << mod_id << " icon: >" << icon << "<" << std::endl;
+  }
+  if(icon.empty()) {
+    // Sometimes id has id.xx.xx format, the first element must be extracted
+    std::string::size_type pos = id.find('.');
+    std::string mod_id;
+    if(pos != std::string::npos)
+      mod_id = id.substr(0, pos);
+    icon = suggested_icon_for_id(mod_id);
+    debug << "\ticon for id: " << mod_id << " icon: >" << icon << "<" << std::endl;
+    if(icon.empty()) {
+      // Sometimes id is in D-BUS format: xx.xx.id, where id is in PascalCase
+      // Change id of icon to lower case (icons are saved as lower case files)
+      for(char &ch : mod_id) {ch = std::tolower(ch);}
+      icon = suggested_icon_for_id(mod_id);
+      debug << "\ticon for id: " << mod_id << " icon: >" << icon << "<" << std::endl;
+    }
+  }
+  if(icon.empty()) {
+    // Sometimes id has xx.xx.id format, the last element must be extracted
+    std::string::size_type pos = id.find_last_of('.');
+    std::string mod_id;
+    if(pos != std::string::npos)
+      mod_id = id.substr(pos + 1);
+    icon = suggested_icon_for_id(mod_id);
+    debug << "\ticon for id: " << mod_id << " icon: >" << icon << "<" << std::endl;
+    if(icon.empty()) {
+      // Sometimes id is in D-BUS format: xx.xx.id, where id is in PascalCase
+      // Change id of icon to lower case (icons are saved as lower case files)
+      for(char &ch : mod_id) {ch = std::tolower(ch);}
+      icon = suggested_icon_for_id(mod_id);
+      debug << "\ticon for id: " << mod_id << " icon: >" << icon << "<" << std::endl;
+    }
+  }
+  const std::string *exec_icon = IconIndex::get_index()->find_exec(id);
+  if(icon.empty() && exec_icon != nullptr) {
+    icon = *exec_icon;
+    debug << "\ticon for id: " << id << " icon: >" << icon << "<" << std::endl;
+  }
+  if(icon.empty()) {
+    icon = suggested_icon_for_id(std::string("dialog-question"));
+    debug << "not icon found for id " << id << std::endl;
+  }
+  // Icons found before desktop files are indexed can be wrong
+  if(IconIndex::get_index()->ready())
+    app_id_icons[app_id] = icon;
+  return icon;
+}
+
+void ToplevelButton::update_icon()
+{
+  if(m_id->empty())
+    return;
+  std::string icon = icon_for_app_id(*m_id);
+  if(icon.empty())
+    init(icon, *m_id);
+  else
+    init(icon, std::string());
+}
+
+void ToplevelButton::activate()
+{
+  if(!m_toplevel_handle)
+    return;
+  if(m_minimized)
+    m_toplevel_handle.unset_minimized();
+  m_toplevel_handle.activate(m_seat);
+}
+
 void ToplevelButton::mouse_clicked(int button)
 {
   if(!m_activated) {
-    if(m_minimized)
-      m_toplevel_handle.unset_minimized();
-    m_toplevel_handle.activate(m_seat);
-    for(auto b : *m_toplevels)
-      b->set_selected(false);
-    set_selected(true);
-  } else {
+    activate();
+    select(true);
+  } else if(m_toplevel_handle) {
     if(button == BTN_LEFT) {
       if(m_maximized)
         m_toplevel_handle.unset_maximized();
@@ -161,16 +276,15 @@ void ToplevelButton::mouse_clicked(int button)
   }
 }
 
-void ToplevelButton::update_states(wayland::array_t toplevel_states)
+void ToplevelButton::update_states(const States & states)
 {  
   m_maximized = m_activated = m_minimized = m_fullscreen = false;
-  set_selected(false);
-  auto states = static_cast<std::vector<wayland::zwlr_foreign_toplevel_handle_v1_state> >(toplevel_states);
+  bool activated = false;
   for(wayland::zwlr_foreign_toplevel_handle_v1_state state : states) {
     switch(state) {
       case wayland::zwlr_foreign_toplevel_handle_v1_state::activated:
         m_activated = true;
-        set_selected(true);
+        activated = true;
         break;
       case wayland::zwlr_foreign_toplevel_handle_v1_state::maximized:
         m_maximized = true;
@@ -185,6 +299,23 @@ void ToplevelButton::update_states(wayland::array_t toplevel_states)
         break;
     };
   }
+  select(activated);
+}
+
+void ToplevelButton::select(bool selected)
+{
+  if(selected) {
+    if(m_toplevels->selected != nullptr && m_toplevels->selected != this)
+      m_toplevels->selected->set_selected(false);
+    m_toplevels->selected = this;
+  } else if(m_toplevels->selected == this)
+    m_toplevels->selected = nullptr;
+  set_selected(selected);
+}
+
+void ToplevelButton::set_handle(SlotHandle handle)
+{
+  m_handle = handle;
 }
 
 bool ToplevelButton::is_fullscreen()
@@ -192,23 +323,31 @@ bool ToplevelButton::is_fullscreen()
   return m_fullscreen;
 }
 
+bool ToplevelButton::is_activated()
+{
+  return m_activated;
+}
+
+const std::string & ToplevelButton::get_app_id()
+{
+  return *m_id;
+}
+
+const std::string & ToplevelButton::get_title()
+{
+  return m_title;
+}
+
 static std::string get_icon_from_desktop_file(std::string path, std::string id)
 {
   std::string icon;
   std::filesystem::path p(path + id + std::string(".desktop"));
   debug << "desktop file " << p.string() << std::endl;
-  std::filesystem::directory_entry entry(p);
-  if(entry.exists()) {
-    std::ifstream in(p.c_str());
-    std::regex re("^Icon=(.*)");
-    for( std::string line; std::getline(in, line); ) {
-      std::smatch m;
-      if(std::regex_match(line, m, re)) {
-        icon = m[1];
-        debug << "icon found in desktop file " << icon << std::endl;
-        break;
-      }
-    }
+  IniFile in(p.string());
+  if(in.is_open()) {
+    icon = std::string(in.get("Desktop Entry", "Icon"));
+    if(!icon.empty())
+      debug << "icon found in desktop file " << icon << std::endl;
   } else {
     debug << "desktop file " << p.string() << " doesn't exists." << std::endl;
   }
@@ -249,33 +388,40 @@ void ToplevelButton::mouse_enter()
 }
 
 // Builds a map with executable and related icon
-std::unordered_map<std::string, std::string> init_icon_exec_map()
+void ToplevelButton::clear_app_id_icons()
+{
+  app_id_icons.clear();
+}
+
+void ToplevelButton::add_index_tasks(IconIndex *index)
 {
   std::vector<std::string> paths = { Settings::get_env("XDG_DATA_HOME") + "/applications/", "/usr/local/share/applications/", "/usr/share/applications/" };
-  std::unordered_map<std::string, std::string> map; 
   for(std::string path : paths) {
-    if(std::filesystem::directory_entry(std::filesystem::path(path)).exists()) {
-      for(std::filesystem::directory_entry entry : std::filesystem::directory_iterator(path)) {
-        if( ".desktop" == entry.path().extension()) {
-          // Read content
-          std::ifstream in(entry.path().c_str());
-          std::regex re_icon("^Icon=(.*)");
-          std::regex re_exec("^Exec=([^ ]*).*");
-          std::string icon, exec;
-          for( std::string line; std::getline(in, line); ) {
-            std::smatch m;
-            if(std::regex_match(line, m, re_icon)) {
-              icon = m[1];
-            } else if(std::regex_match(line, m, re_exec)) {
-              exec = std::filesystem::path(m[1]).filename();
-            }
-          }
-          map[exec] = icon;
+    index->add_task([path](IconIndexPartial & partial) {
+      index_desktop_files(path, partial);
+    });
+  }
+}
+
+void ToplevelButton::index_desktop_files(const std::string & path, IconIndexPartial & partial)
+{
+  std::error_code error;
+  for(const std::filesystem::directory_entry & entry : std::filesystem::directory_iterator(path, error)) {
+    if( ".desktop" == entry.path().extension()) {
+      // Read content
+      IniFile in(entry.path().string());
+      std::string_view group, key, value;
+      std::string icon, exec;
+      while(in.next(group, key, value)) {
+        if(group != "Desktop Entry")
+          continue;
+        if(key == "Icon") {
+          icon = std::string(value);
+        } else if(key == "Exec") {
+          exec = std::filesystem::path(std::string(value.substr(0, value.find(' ')))).filename();
         }
-        entry.refresh();
       }
+      partial.execs.emplace(exec, icon);
     }
   }
-  return map;
 }
-
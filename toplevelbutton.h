@@ -17,10 +17,29 @@
 #define __TOPLEVEL_BUTTON_H__
 
 #include <string>
+#include <functional>
 #include <wayland-client.hpp>
 #include <wayland-client-protocol-extra.hpp>
 #include "button.h"
 #include "toplevel.h"
+#include "slotmap.h"
+#include "toplevelpool.h"
+
+class ToplevelButton;
+
+/*! \struct ToplevelList
+ *  \brief Windows shown in panel.
+ *
+ *  selected is the window which is drawn as selected. It is tracked here, 
+ *  so selecting a window doesn't need to unselect all windows.
+ *  pool keeps icons of closed windows to be reused by new windows.
+ */
+struct ToplevelList
+{
+  SlotMap<std::shared_ptr<ToplevelButton> > buttons;
+  ToplevelButton *selected = nullptr;
+  ToplevelPool pool;
+};
 
 
 /*! \class ToplevelButton
@@ -31,26 +50,87 @@
 class ToplevelButton : public Button
 {
 public:
-  ToplevelButton(wayland::zwlr_foreign_toplevel_handle_v1_t toplevel_handle, wayland::seat_t seat, std::vector<std::shared_ptr<ToplevelButton> > *toplevels);
+  typedef std::vector<wayland::zwlr_foreign_toplevel_handle_v1_state> States;
+
+  /** toplevel_handle can be empty to replay recorded events. Then events 
+   *  are sent calling on_title, on_app_id,...
+   */
+  ToplevelButton(wayland::zwlr_foreign_toplevel_handle_v1_t toplevel_handle, wayland::seat_t seat, ToplevelList *toplevels);
+
+  // Events of the window
+  void on_title(const std::string & title);
+  void on_app_id(const std::string & app_id);
+  void on_state(const States & states);
+  void on_done();
+  void on_closed();
+  /** Identifier of the window in recorded events. */
+  uint32_t get_event_id();
 
   virtual void mouse_clicked(int button) override;
   virtual void mouse_enter() override;
 
   std::function<void(bool)> repaint_main_interface;
+  /** Called when application id changes. old_app_id is the previous id.
+   */
+  std::function<void(ToplevelButton *, const std::string & old_app_id)> app_id_changed;
+  /** Called when window is closed, before button is removed.
+   */
+  std::function<void(ToplevelButton *)> closed;
+
+  /** Sets handle of this button in ToplevelList.
+   */
+  void set_handle(SlotHandle handle);
 
   bool is_fullscreen();
+  bool is_activated();
+  /** Returned string is interned: windows with the same application id 
+   *  return the same string, and its address can be used as key.
+   */
+  const std::string & get_app_id();
+  const std::string & get_title();
+  /** Focus the window. It is unminimized if needed.
+   */
+  void activate();
+  /** Searches the icon of the application again. Icons searched before
+   *  desktop files are indexed can be wrong.
+   */
+  void update_icon();
+
+  /** Adds tasks to index desktop files. One task for each applications path.
+   */
+  static void add_index_tasks(IconIndex *index);
+  /** Adds icons of executables of desktop files in path to partial.
+   *  It is the index task of each applications path.
+   */
+  static void index_desktop_files(const std::string & path, IconIndexPartial & partial);
+  /** Forgets the icons found for application ids.
+   */
+  static void clear_app_id_icons();
 
 private:
   wayland::zwlr_foreign_toplevel_handle_v1_t m_toplevel_handle;
-  std::string m_title, m_id;
+  std::string m_title;
+  const std::string *m_id;
   wayland::output_t m_output;
-  wayland::array_t m_state;
+  States m_state;
+  uint32_t m_event_id;
   wayland::seat_t m_seat;
-  std::vector<std::shared_ptr<ToplevelButton> > *m_toplevels; 
+  ToplevelList *m_toplevels;
+  SlotHandle m_handle;
   bool m_maximized, m_activated, m_minimized, m_fullscreen;
   //std::string m_icon_path;
 
-  void update_states(wayland::array_t toplevel_states);
+  // Changes received before done event
+  struct Pending
+  {
+    bool has_title = false, has_app_id = false, has_state = false;
+    std::string title, app_id;
+    States state;
+  } m_pending;
+
+  void apply_pending();
+  void update_states(const States & states);
+  void select(bool selected);
 };
 
 #endif
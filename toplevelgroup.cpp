@@ -0,0 +1,126 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "toplevelgroup.h"
+#include "style.h"
+#include <algorithm>
+#include <linux/input-event-codes.h>
+
+ToplevelGroup::ToplevelGroup(const std::string & app_id) : Button()
+{
+  m_app_id = app_id;
+  m_next = 0;
+}
+
+void ToplevelGroup::add(ToplevelButton *toplevel)
+{
+  m_toplevels.push_back(toplevel);
+  update();
+}
+
+void ToplevelGroup::remove(ToplevelButton *toplevel)
+{
+  auto iter = std::find(m_toplevels.begin(), m_toplevels.end(), toplevel);
+  if(iter == m_toplevels.end())
+    return;
+  m_toplevels.erase(iter);
+  if(m_next >= m_toplevels.size())
+    m_next = 0;
+  update();
+}
+
+bool ToplevelGroup::empty()
+{
+  return m_toplevels.empty();
+}
+
+size_t ToplevelGroup::size()
+{
+  return m_toplevels.size();
+}
+
+void ToplevelGroup::update()
+{
+  if(m_toplevels.empty())
+    return;
+  ToplevelButton *first = m_toplevels.front();
+  if(first->get_icon() != get_icon())
+    init(first->get_icon(), first->get_icon().empty() ? first->get_text() : std::string());
+  bool selected = false;
+  for(ToplevelButton *toplevel : m_toplevels)
+    selected = selected || toplevel->is_activated();
+  set_selected(selected);
+  m_need_repaint = true;
+}
+
+void ToplevelGroup::paint(cairo_t *cr)
+{
+  Button::paint(cr);
+  if(m_toplevels.size() < 2)
+    return;
+
+  // Draws number of windows at the bottom right corner
+  std::string count = std::to_string(m_toplevels.size());
+  std::shared_ptr<const Style> style = Style::get_style();
+  cairo_set_scaled_font(cr, style->label_font());
+  cairo_text_extents_t extents;
+  cairo_text_extents(cr, count.c_str(), &extents);
+  double x = m_x + m_width - extents.width - 4;
+  double y = m_y + m_height - 2;
+  cairo_set_source(cr, style->label_background());
+  cairo_rectangle(cr, x - 2, y - extents.height - 2, extents.width + 4, extents.height + 4);
+  cairo_fill(cr);
+  cairo_set_source(cr, style->foreground());
+  cairo_move_to(cr, x - extents.x_bearing, y);
+  cairo_show_text(cr, count.c_str());
+}
+
+void ToplevelGroup::mouse_clicked(int button)
+{
+  if(m_toplevels.empty())
+    return;
+  if(m_toplevels.size() == 1) {
+    m_toplevels.front()->mouse_clicked(button);
+    return;
+  }
+
+  // Actions other than left click are sent to the active window
+  auto active = std::find_if(m_toplevels.begin(), m_toplevels.end(), 
+      [](ToplevelButton *toplevel) { return toplevel->is_activated(); });
+  if(button != BTN_LEFT) {
+    if(active != m_toplevels.end())
+      (*active)->mouse_clicked(button);
+    return;
+  }
+
+  // Left click cycles windows
+  if(active != m_toplevels.end())
+    m_next = (active - m_toplevels.begin() + 1) % m_toplevels.size();
+  debug << "Activating window " << m_next << " of " << m_app_id << std::endl;
+  m_toplevels[m_next]->activate();
+  m_next = (m_next + 1) % m_toplevels.size();
+}
+
+void ToplevelGroup::mouse_enter()
+{
+  std::string titles;
+  for(ToplevelButton *toplevel : m_toplevels) {
+    if(!titles.empty())
+      titles += "\n";
+    titles += toplevel->get_title();
+  }
+  show_tooltip(titles);
+}
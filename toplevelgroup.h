@@ -0,0 +1,59 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __TOPLEVEL_GROUP_H__
+#define __TOPLEVEL_GROUP_H__
+
+#include <string>
+#include <vector>
+#include "button.h"
+#include "toplevelbutton.h"
+
+/*! \class ToplevelGroup
+ *  \brief Button that shows all windows of an application.
+ *
+ *  When "group_toplevels" is set, panel shows one ToplevelGroup for each
+ *  application id instead of one ToplevelButton for each window.
+ *  Number of windows is drawn over the icon. Clicking the group activates
+ *  the next window of the group. If group has only one window, it works 
+ *  like a ToplevelButton.
+ *
+ *  Windows are owned by panel. Group only keeps pointers to them, so they
+ *  must be removed from the group before they are deleted.
+ */
+class ToplevelGroup : public Button
+{
+public:
+  ToplevelGroup(const std::string & app_id);
+
+  void add(ToplevelButton *toplevel);
+  void remove(ToplevelButton *toplevel);
+  bool empty();
+  size_t size();
+  /** Updates icon and selected state from windows.
+   */
+  void update();
+
+  virtual void paint(cairo_t *cr) override;
+  virtual void mouse_clicked(int button) override;
+  virtual void mouse_enter() override;
+
+private:
+  std::string m_app_id;
+  std::vector<ToplevelButton *> m_toplevels;
+  size_t m_next; // Next window to be activated
+};
+
+#endif
@@ -0,0 +1,77 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "toplevelpool.h"
+#include "stats.h"
+
+ToplevelPool::ToplevelPool(size_t max_bytes)
+{
+  m_bytes = 0;
+  m_max_bytes = max_bytes;
+}
+
+void ToplevelPool::put(const std::string *app_id, Button::IconCache && cache)
+{
+  size_t bytes = cache.bytes();
+  if(cache.icon == nullptr || bytes > m_max_bytes)
+    return;
+
+  // Only one entry is saved for each application
+  auto item = m_map.find(app_id);
+  if(item != m_map.end()) {
+    m_bytes -= item->second->bytes;
+    m_entries.erase(item->second);
+    m_map.erase(item);
+  }
+
+  m_bytes += bytes;
+  m_entries.push_front(Entry{app_id, std::move(cache), bytes});
+  m_map[app_id] = m_entries.begin();
+
+  static uint64_t *evictions = Stats::get_stats()->counter("toplevel_pool_evictions");
+  while(m_bytes > m_max_bytes) {
+    Entry & last = m_entries.back();
+    debug << "Removing " << *last.app_id << " from toplevel pool" << std::endl;
+    m_bytes -= last.bytes;
+    m_map.erase(last.app_id);
+    m_entries.pop_back();
+    (*evictions)++;
+  }
+}
+
+void ToplevelPool::clear()
+{
+  m_map.clear();
+  m_entries.clear();
+  m_bytes = 0;
+}
+
+bool ToplevelPool::take(const std::string *app_id, Button::IconCache & cache)
+{
+  static uint64_t *hits = Stats::get_stats()->counter("toplevel_pool_hits");
+  static uint64_t *misses = Stats::get_stats()->counter("toplevel_pool_misses");
+  auto item = m_map.find(app_id);
+  if(item == m_map.end()) {
+    (*misses)++;
+    return false;
+  }
+  m_bytes -= item->second->bytes;
+  cache = std::move(item->second->cache);
+  m_entries.erase(item->second);
+  m_map.erase(item);
+  (*hits)++;
+  return true;
+}
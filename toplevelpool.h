@@ -0,0 +1,64 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __TOPLEVEL_POOL_H__
+#define __TOPLEVEL_POOL_H__
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include "button.h"
+
+#define TOPLEVEL_POOL_MAX_BYTES (2 * 1024 * 1024)
+
+/*! \class ToplevelPool
+ *  \brief Icons of recently closed windows.
+ *
+ *  Dialogs and file pickers are opened and closed often. When a window is
+ *  closed, its icon and rasterized icon are saved here by application id.
+ *  A new window of the same application takes them without loading or 
+ *  rendering the icon again.
+ *  Least recently closed entries are removed when the entries use more than
+ *  max_bytes (see Button::IconCache::bytes()).
+ */
+class ToplevelPool
+{
+public:
+  ToplevelPool(size_t max_bytes = TOPLEVEL_POOL_MAX_BYTES);
+
+  /** Saves cache of a closed window. app_id must be interned.
+   */
+  void put(const std::string *app_id, Button::IconCache && cache);
+  /** Gets cache of a closed window of application app_id. Returns false if
+   *  there isn't any.
+   */
+  bool take(const std::string *app_id, Button::IconCache & cache);
+  /** Removes all entries.
+   */
+  void clear();
+
+private:
+  struct Entry
+  {
+    const std::string *app_id;
+    Button::IconCache cache;
+    size_t bytes;
+  };
+  std::list<Entry> m_entries; // Most recent first
+  std::unordered_map<const std::string *, std::list<Entry>::iterator> m_map;
+  size_t m_bytes, m_max_bytes;
+};
+
+#endif
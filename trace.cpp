@@ -0,0 +1,120 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "debug.h"
+#include "trace.h"
+#include "eventloop.h"
+#include <fstream>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+
+bool m_trace = false;
+
+Trace *Trace::get_trace()
+{
+  static Trace trace;
+  return &trace;
+}
+
+Trace::Trace()
+{
+  m_signal_fd = -1;
+}
+
+Trace::~Trace()
+{
+  if(m_signal_fd >= 0)
+    close(m_signal_fd);
+}
+
+void Trace::start(const std::string & path)
+{
+  m_path = path;
+  m_trace = true;
+
+  // SIGUSR2 writes the trace file
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGUSR2);
+  if(sigprocmask(SIG_BLOCK, &mask, nullptr) == 0)
+    m_signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if(m_signal_fd >= 0) {
+    EventLoop::add_fd(m_signal_fd, POLLIN, [this](short revents) {
+      struct signalfd_siginfo info;
+      while(read(m_signal_fd, &info, sizeof(info)) == sizeof(info))
+        write();
+    });
+  }
+}
+
+Trace::Ring *Trace::thread_ring()
+{
+  static thread_local Ring *ring = nullptr;
+  if(ring == nullptr) {
+    std::lock_guard<std::mutex> lock(m_rings_mutex);
+    m_rings.push_back(std::make_unique<Ring>());
+    ring = m_rings.back().get();
+    ring->head = 0;
+    ring->tid = syscall(SYS_gettid);
+  }
+  return ring;
+}
+
+void Trace::add(const char *name, uint64_t start_usecs, uint64_t duration_usecs)
+{
+  Ring *ring = thread_ring();
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  Event & event = ring->events[head & (TRACE_RING_SIZE - 1)];
+  event.name = name;
+  event.start_usecs = start_usecs;
+  event.duration_usecs = duration_usecs;
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+/** Threads can save spans while the file is written. If a thread saves
+ *  a lot of spans, its oldest spans can be overwritten while they are read.
+ */
+void Trace::write()
+{
+  std::ofstream out(m_path);
+  if(!out) {
+    debug_error << "Trace cannot be written to " << m_path << ": " << strerror(errno) << std::endl;
+    return;
+  }
+  pid_t pid = getpid();
+  bool first = true;
+  out << "{\"traceEvents\":[\n";
+  std::lock_guard<std::mutex> lock(m_rings_mutex);
+  for(const std::unique_ptr<Ring> & ring : m_rings) {
+    if(!first)
+      out << ",\n";
+    first = false;
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << ring->tid
+      << ",\"args\":{\"name\":\"" << (ring->tid == pid ? "main" : "worker") << "\"}}";
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t n = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+    for(; n < head; n++) {
+      const Event & event = ring->events[n & (TRACE_RING_SIZE - 1)];
+      out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"ts\":" << event.start_usecs
+        << ",\"dur\":" << event.duration_usecs << ",\"pid\":" << pid << ",\"tid\":" << ring->tid << "}";
+    }
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  debug << "Trace written to " << m_path << std::endl;
+}
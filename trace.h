@@ -0,0 +1,111 @@
+
+/*
+ * Copyright 2021 P.L. Lucas <selairi@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "stats.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// Events kept for each thread. It must be a power of two.
+#define TRACE_RING_SIZE (1 << 16)
+
+extern bool m_trace;
+
+/*! \class Trace
+ *  \brief Spans of time saved to a Chrome trace file (chrome://tracing, ui.perfetto.dev).
+ *
+ *  Each thread writes its spans in its own ring buffer without locks. The 
+ *  last TRACE_RING_SIZE spans of each thread are written to the file when
+ *  panel exits or when SIGUSR2 is received.
+ *  Spans are recorded with TRACE_SCOPE:
+ *    void Item::paint(cairo_t *cr)
+ *    {
+ *      TRACE_SCOPE("Item::paint");
+ *      ...
+ *    }
+ *  If tracing is not enabled, TRACE_SCOPE only checks m_trace.
+ */
+class Trace
+{
+public:
+  static Trace *get_trace();
+  Trace();
+  ~Trace();
+
+  /** Enables tracing. Spans will be written to path. */
+  void start(const std::string & path);
+  /** Saves a span of the current thread. name must be a string literal. */
+  void add(const char *name, uint64_t start_usecs, uint64_t duration_usecs);
+  /** Writes spans of all threads to the trace file. */
+  void write();
+
+private:
+  struct Event
+  {
+    const char *name;
+    uint64_t start_usecs;
+    uint64_t duration_usecs;
+  };
+
+  struct Ring
+  {
+    Event events[TRACE_RING_SIZE];
+    std::atomic<uint64_t> head; // Number of events written
+    pid_t tid;
+  };
+
+  Ring *thread_ring();
+
+  std::mutex m_rings_mutex;
+  std::vector<std::unique_ptr<Ring> > m_rings;
+  std::string m_path;
+  int m_signal_fd;
+};
+
+/*! \class TraceScope
+ *  \brief Saves a span from its creation to the end of its scope. See TRACE_SCOPE.
+ */
+class TraceScope
+{
+public:
+  TraceScope(const char *name) : m_name(name), m_start(0)
+  {
+    if(__builtin_expect(m_trace, 0))
+      m_start = Stats::now_usecs();
+  }
+  ~TraceScope()
+  {
+    if(__builtin_expect(m_trace, 0))
+      Trace::get_trace()->add(m_name, m_start, Stats::now_usecs() - m_start);
+  }
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+  const char *m_name;
+  uint64_t m_start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif
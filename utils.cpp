@@ -15,8 +15,10 @@
   
 #include "debug.h"
 #include "utils.h"
+#include "framearena.h"
 #include <stdio.h>
 #include <vector>
+#include <unordered_set>
 
 std::string Utils::read_command(std::string command)
 {
@@ -37,22 +39,25 @@ std::string Utils::read_command(const char *command)
 }
 
 // Get lines of text
-std::vector<std::string> get_lines(std::string text)
+std::pmr::vector<const char *> get_lines(std::string_view text)
 {
-  std::vector<std::string> lines;
+  FrameArena *arena = FrameArena::get_arena();
+  std::pmr::vector<const char *> lines(arena->resource());
   size_t start = 0;
-  size_t end = text.find("\n");
-  if(end == std::string::npos)
-    lines.push_back(text);
-  else { 
-    while (end != std::string::npos) {
-      lines.push_back(text.substr(start, end - start));
-      start = end + 1;
-      end = text.find("\n", start);
-    }
-    lines.push_back(text.substr(start));
+  size_t end = text.find('\n');
+  while (end != std::string_view::npos) {
+    lines.push_back(arena->c_str(text.substr(start, end - start)));
+    start = end + 1;
+    end = text.find('\n', start);
   }
+  lines.push_back(arena->c_str(text.substr(start)));
 
   return lines;
 }
 
+
+const std::string *intern_string(const std::string & text)
+{
+  static std::unordered_set<std::string> strings;
+  return &(*strings.insert(text).first);
+}
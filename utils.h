@@ -17,7 +17,9 @@
 #define __UTILS_H__
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory_resource>
 
 /*! \class Utils
  *  \brief a simple set of utils to exec commands.
@@ -31,7 +33,12 @@ class Utils
     static std::string read_command(const char *command);
 };
 
-// Get lines of text
-std::vector<std::string> get_lines(std::string text);
+// Get lines of text. Lines are copied to the FrameArena: they end with '\0'
+// and they are valid until the frame is finished.
+std::pmr::vector<const char *> get_lines(std::string_view text);
+
+// Returns an unique copy of text. Equal texts return the same pointer,
+// so they can be compared and hashed by pointer. Copies are never freed.
+const std::string *intern_string(const std::string & text);
 
 #endif